@@ -38,6 +38,8 @@
 #include <WProgram.h>
 #endif
 
+#include "max7219_spi.h"
+
 /*
  * Segments to be switched on for characters and digits on
  * 7-Segment Displays
@@ -63,10 +65,16 @@ const static byte charTable [] PROGMEM  = {
 
 class LedControl {
     private :
+        /* SPI host backend, owned by this object */
+        Max7219Spi spi;
+        /* false when the pins are bit-banged */
+        bool useSpi;
         /* The array for shifting the data to the devices */
         byte spidata[16];
         /* Send out a single command to the device */
         void spiTransfer(int addr, byte opcode, byte data);
+        /* Shift spidata through the whole chain in one CS window */
+        void sendChain();
 
         /* We keep track of the led-status for all 8 devices in this array */
         byte status[64];
@@ -87,8 +95,24 @@ class LedControl {
          * clockPin		pin for the clock
          * csPin		pin for selecting the device 
          * numDevices	maximum number of devices that can be controled
+         * spiHost	ESP32 SPI host (1: HSPI, 2: VSPI) to drive the pins with
+         *		queued DMA transfers, or -1 to bit-bang them. Falls back
+         *		to bit-banging if the host cannot be claimed.
+         */
+        LedControl(int dataPin, int clkPin, int csPin, int numDevices=1,
+                   int spiHost=-1);
+
+        /* The SPI backend cannot be shared, so neither can the controler */
+        LedControl(const LedControl&) = delete;
+        LedControl& operator=(const LedControl&) = delete;
+
+        /*
+         * Move this controler to other pins and initialize the devices
+         * again. Params are those of the constructor; an SPI host claimed
+         * before is given back first.
          */
-        LedControl(int dataPin, int clkPin, int csPin, int numDevices=1);
+        void begin(int dataPin, int clkPin, int csPin, int numDevices=1,
+                   int spiHost=-1);
 
         /*
          * Gets the number of devices attached to this LedControl.
@@ -185,4 +209,34 @@ class LedControl {
          * dp	sets the decimal point.
          */
         void setChar(int addr, int digit, char value, boolean dp);
+
+        /*
+         * Set the same row on every device of the chain in a single
+         * transfer. setRow() shifts the whole chain for one device, so
+         * this updates all devices for the bus time of one setRow().
+         * Params:
+         * row	row which is to be set (0..7)
+         * values	one byte per device, values[addr] for device addr
+         */
+        void setRowAll(int row, const byte* values);
+
+        /*
+         * Get the segments of a row (digit) as they were last sent.
+         * Params:
+         * addr	address of the display
+         * row	the row of the display (0..7)
+         * Returns :
+         * byte	the segment byte, 0 for an invalid addr or row
+         */
+        byte getRow(int addr, int row);
+
+        /*
+         * The segment byte setChar() sends for a character, so a caller
+         * can compose a whole frame and write only the rows that changed
+         * with setRow().
+         * Params:
+         * value	the character (see setChar)
+         * dp	sets the decimal point.
+         */
+        static byte charSegments(char value, boolean dp);
 };
@@ -13,10 +13,10 @@ class Buttons {
     uint32_t long_press_ms_;
     uint8_t ps_ = 255;  // start button pin
     bool last_ = true, stable_ = true;
-    uint32_t t_ = 0;
+    uint64_t t_us_ = 0;  // last raw edge (monoUs)
     bool edge_ = false;
     bool long_edge_ = false;
     bool pressed_ = false;
-    uint32_t pressed_since_ = 0;
+    uint64_t pressed_since_us_ = 0;
     bool long_latched_ = false;
 };
@@ -25,6 +25,17 @@ constexpr bool DISPLAY_RIGHT_TO_LEFT = true;
 constexpr uint8_t DISPLAY_INTENSITY  = 4;   // 0..15
 constexpr uint32_t DISPLAY_IDLE_MS   = 1000/15; // ~15 Hz idle
 constexpr uint32_t DISPLAY_MEAS_MS   = 1000/20; // ~20 Hz while measuring
+// Modules in the chain (DIN -> DOUT -> DIN). A second one shows flow (g/s)
+// and seconds to the setpoint while measuring; 1 drives a single module.
+constexpr uint8_t DISPLAY_MODULES    = 2;       // 1..8
+// MAX7219 over the SPI peripheral with DMA (pins routed through the GPIO
+// matrix); -1 bit-bangs DIN/CLK/CS from the CPU instead
+constexpr int      DISPLAY_SPI_HOST  = 2;       // SPI3_HOST (VSPI)
+constexpr int      DISPLAY_SPI_HZ    = 5000000; // MAX7219 allows 10 MHz
+// Render task: below the sampling task and next to the log drain
+constexpr BaseType_t DISPLAY_TASK_CORE      = 0;
+constexpr UBaseType_t DISPLAY_TASK_PRIORITY = 1;
+constexpr uint32_t DISPLAY_TASK_STACK       = 3072;
 
 // ---------------- Scale & filtering ----------------
 // Compile-time offsets
@@ -37,6 +48,11 @@ constexpr int32_t CUTOFF_OFFSET_MG      = 0;        // legacy fixed offset (kept
 // Example: 22000/(-155332+326407) = 0.1286 mg/count => (int32)((0.1286f * 65536.0f) + 0.5f) = 9437
 constexpr int32_t CAL_MG_PER_COUNT_Q16  = (int32_t)((0.1286f * 65536.0f) + 0.5f); // <-- TUNE ME
 
+// HX711 readout over the SPI peripheral (DT on MISO, SCK on SCLK)
+constexpr int      HX711_SPI_HOST       = 1;        // SPI2_HOST (HSPI); VSPI drives the display
+constexpr int      HX711_SPI_HZ         = 1000000;  // SCK high 0.5 us (datasheet: 0.2..50 us)
+constexpr uint8_t  HX711_GAIN_PULSES    = 1;        // 1: A/128, 2: B/32, 3: A/64
+
 // HX711 sampling periods (switch at runtime)
 constexpr uint16_t HX711_PERIOD_IDLE_MS = 100; // 10 SPS for quiet, stable display
 constexpr uint16_t HX711_PERIOD_FAST_MS = 12;  // ~80 SPS during measuring
@@ -44,6 +60,34 @@ constexpr uint16_t HX711_PERIOD_FAST_MS = 12;  // ~80 SPS during measuring
 constexpr uint32_t NOTREADY_MULT        = 3;   // x times expected period
 constexpr uint32_t NOTREADY_MARGIN_MS   = 10;  // extra slack
 
+// Sampling task (woken by HX711 DRDY, runs read + estimator right away)
+// loop() runs on core 1 at priority 1; stay on the same core but preempt it.
+constexpr BaseType_t SCALE_TASK_CORE     = 1;
+constexpr UBaseType_t SCALE_TASK_PRIORITY = 5;
+constexpr uint32_t SCALE_TASK_STACK      = 4096;
+// Sample ring between sampling task and controller (power of two); the
+// controller can look back SAMPLE_RING_HISTORY consumed samples in place
+constexpr uint32_t SAMPLE_RING_SIZE      = 64;
+constexpr uint32_t SAMPLE_RING_HISTORY   = 16;
+
+// Hot-path profiler (PROF_SCOPE in profiler.h, "p" on serial prints a
+// report); 0 compiles every scope out
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+constexpr uint8_t  PROF_BUCKETS          = 16;  // histogram buckets, x2 each
+constexpr uint8_t  PROF_BUCKET0_LOG2     = 6;   // first bucket: < 128 cycles
+
+// Logging: callers queue binary records, a low-priority task on the other
+// core formats them and writes the UART (logging.h)
+constexpr uint8_t  LOG_LEVEL_COMPILED    = 2;     // 0 error, 1 warn, 2 info, 3 debug
+constexpr uint32_t LOG_MODULES_COMPILED  = 0x7F;  // bit per logging::Module
+constexpr uint32_t LOG_QUEUE_LEN         = 32;    // records, power of two
+constexpr BaseType_t LOG_TASK_CORE       = 0;
+constexpr UBaseType_t LOG_TASK_PRIORITY  = 1;
+constexpr uint32_t LOG_TASK_STACK        = 3072;
+constexpr uint32_t LOG_DRAIN_MS          = 20;    // drain period
+
 // Slow display filter
 constexpr uint8_t  IIR_ALPHA_DIV        = 4;   // alpha = 1/4 = 0.25
 
@@ -58,6 +102,8 @@ constexpr uint32_t MEASURE_TIMEOUT_MS   = 20000;
 constexpr float ENC_TPS_FAST  = 100.0f; // > fast => 1.0 g
 constexpr float ENC_TPS_MED   = 50.0f;  // > med  => 0.5 g
 
+constexpr int32_t ENC_STEPS_PER_DETENT = 4;  // quadrature transitions per click
+
 // Step sizes (grams)
 constexpr float ENC_STEP_SLOW_G = 0.025f;
 constexpr float ENC_STEP_MED_G  = 0.1f;
@@ -67,7 +113,8 @@ constexpr float ENC_STEP_FAST_G = 0.5f;
 constexpr uint32_t DEBOUNCE_MS          = 25;
 
 // ---------------- Stability detection ----------------
-constexpr uint8_t  STAB_WINDOW_SAMPLES = 10;   // 1.0 s at 10 Hz
+constexpr uint32_t STAB_WINDOW_MS      = 1000; // same time span in idle and fast mode
+constexpr uint32_t STAB_WINDOW_MAX_SAMPLES = 128; // power of 2; >= window at 80 SPS
 constexpr int32_t  STAB_STDDEV_MG      = 30;   // 0.03 g
 constexpr int32_t  STAB_P2P_MG         = 100;  // 0.10 g
 constexpr uint32_t STAB_DWELL_MS       = 300;  // must remain quiet for this long
@@ -80,8 +127,13 @@ constexpr float    CAL_SPAN_MASS_G      = 22.0f; // known weight for span step,
 constexpr char NVS_NAMESPACE[] = "coffee";
 constexpr char KEY_CAL_Q16[]   = "cal_q16";
 constexpr char KEY_TARE_RAW[]  = "tare_raw";
+constexpr char KEY_PROFILES[]  = "profiles"; // all dosing profiles (blob)
+constexpr char KEY_TAU_RELAY[] = "tau_relay"; // actuator latency (blob)
+constexpr char KEY_TAU_PLUG[]  = "tau_plug";
+// legacy single-setup keys, migrated into the first profile on first boot
 constexpr char KEY_SETPOINT[]  = "setpoint";
-constexpr char KEY_KV[]        = "k_v";      // learned mg per (g/s)
+constexpr char KEY_KV[]        = "k_v";
+constexpr char KEY_OT[]        = "ot";
 
 // Behavior flags
 constexpr bool REQUIRE_STABLE_FOR_TARE = true;
@@ -90,16 +142,108 @@ constexpr bool REQUIRE_STABLE_FOR_CAL  = true;
 // Hint timing
 constexpr uint32_t HINT_HOLD_MS        = 600;
 
+// ---------------- Fast estimator (x, v, a for the cutoff) ----------------
+// 1: constant-acceleration Kalman filter; 0: α–β filter + accel EMA
+#ifndef SCALE_ESTIMATOR_KALMAN
+#define SCALE_ESTIMATOR_KALMAN 1
+#endif
+// Kalman noise per sampling mode: white-jerk density (mg^2/s^5), HX711 variance (mg^2)
+constexpr float KF_Q_JERK_FAST = 1.0e6f;  // measuring: motor ramp, bursty flow
+constexpr float KF_R_FAST_MG2  = 400.0f;  // ~20 mg RMS at 80 SPS
+constexpr float KF_Q_JERK_IDLE = 1.0e4f;  // idle: cup at rest, track slow changes
+constexpr float KF_R_IDLE_MG2  = 400.0f;
+
 // ---------------- Dynamic cutoff model ----------------
-// Latencies (ms) used to compute offset = v*tau + 0.5*a*tau^2 + k_v*v
+// Latencies (ms) used to compute offset = v*tau_meas + 0.5*a*tau_meas^2 +
+// v_avg*tau_comm + learned correction
 // Derive measurement latency from fast HX711 period plus small processing slack
 constexpr uint32_t TAU_MEAS_MS = HX711_PERIOD_FAST_MS + 3;  // estimator + sampling latency
-// Optocoupler + electromechanical relay turn-off time (empirical 8–10 ms)
-constexpr uint32_t TAU_COMM_MS = 9;                         // switch OFF latency (tune to your device)
+// Optocoupler + electromechanical relay turn-off time (empirical 8–10 ms);
+// only the starting point of the learned latency, see below
+constexpr uint32_t TAU_COMM_MS = 9;                         // switch OFF latency
+
+// Measured actuator latency, learned per actuator (GPIO relay or WiFi plug)
+// and blended into TAU_COMM_MS. Each automatic stop times the onset of the
+// flow decay after the relay-off command: the line through the points where
+// the flow falls through TAU_ONSET_HI and TAU_ONSET_LO of the flow at the
+// stop, extended back to the full flow. That flow is a centred difference of
+// the raw readings TAU_ONSET_SPAN samples either side. The latency term
+// multiplies the flow averaged over TAU_FLOW_AVG_MS.
+constexpr uint8_t  TAU_ONSET_SPAN     = 3;
+constexpr float    TAU_ONSET_HI       = 0.8f;
+constexpr float    TAU_ONSET_LO       = 0.5f;  // below what bursts reach
+constexpr uint32_t TAU_FLOW_AVG_MS    = 1000;
+constexpr uint32_t TAU_COMM_MAX_MS    = 1000;  // clamp for one measurement
+constexpr float    TAU_MIN_GAIN       = 0.1f;  // floor of the update rate
+constexpr float    TAU_HUBER_K        = 2.5f;  // clip residuals at K mean deviations
+constexpr float    TAU_DEV_MIN_MS     = 2.0f;
+
+// Cutoff engine: 0 = instantaneous v/a formula above, 1 = least-squares
+// time-to-target over the last FLOW_FIT_SAMPLES fast samples
+constexpr uint8_t  CUTOFF_ENGINE    = 0;
+constexpr uint32_t FLOW_FIT_SAMPLES = 32;   // 0.4 s at 80 SPS
+
+// Evaluate the formula cutoff in the sampling task right after the
+// estimator, switching the relay off before loop() sees the sample
+constexpr bool FAST_CUTOFF = true;
+
+// Switch the relay off between samples: extrapolate when the cutoff
+// condition will hold and arm a one-shot esp_timer for that instant
+constexpr bool CUTOFF_TIMER = true;
+
+// Slow approach: within APPROACH_ZONE_MG of the cutoff the relay is pulsed
+// at APPROACH_DUTY over APPROACH_PERIOD_MS, so the flow the cutoff has to
+// stop is lower. Motor inertia smooths the pulses into a slower flow; the
+// overshoot table is then keyed by the averaged flow, which follows it.
+// 0 disables it; a WiFi plug's latency jitter is longer than a period, so
+// keep it for the GPIO relay.
+constexpr int32_t  APPROACH_ZONE_MG   = 0;     // e.g. 1500 for the last 1.5 g
+constexpr uint32_t APPROACH_PERIOD_MS = 100;   // well below the motor spin-up
+constexpr float    APPROACH_DUTY      = 0.5f;  // on share of each period
+
+// Learned overshoot table: correction (mg) by stop flow and setpoint band
+constexpr uint8_t OT_FLOW_BINS     = 8;
+constexpr float   OT_FLOW_MIN_GPS  = 0.5f;   // first/last bin centre
+constexpr float   OT_FLOW_MAX_GPS  = 4.0f;
+constexpr uint8_t OT_SP_BANDS      = 3;
+constexpr float   OT_SP_EDGES_G[OT_SP_BANDS - 1] = {12.0f, 30.0f};
+constexpr float   OT_MIN_GAIN      = 0.15f;  // floor of the per-bin learning rate
+constexpr float   OT_CONF_MAX      = 20.0f;  // confidence saturates (runs)
+constexpr float   V_MIN_GPS        = 0.15f;  // no learning from runs stopped at ~zero flow
+
+// ---------------- Top-up pulses ----------------
+// After an automatic run that settles more than TOPUP_TOL_MG short, wait for
+// a stable reading and fire relay pulses sized from the profile's learned
+// mass per pulse ms until the dose is inside the band or TOPUP_MAX_PULSES
+// have been fired. 0 pulses disables the phase.
+constexpr uint8_t  TOPUP_MAX_PULSES    = 0;     // per run; e.g. 3 to enable
+constexpr int32_t  TOPUP_TOL_MG        = 100;   // accepted deficit (0.1 g)
+constexpr uint32_t TOPUP_DEAD_MS       = 20;    // pulse ms that add nothing net
+constexpr uint32_t TOPUP_MIN_MS        = 30;
+constexpr uint32_t TOPUP_MAX_MS        = 1000;
+constexpr uint32_t TOPUP_SETTLE_MS     = 800;   // coast-down + fall before reading
+constexpr uint32_t TOPUP_SETTLE_MAX_MS = 5000;  // give up if it never settles
+constexpr float    TOPUP_MIN_GAIN      = 0.2f;  // floor of the pulse model update
+constexpr int32_t  TOPUP_MAX_DEFICIT_X = 5;     // deficits above x TOL: cup moved, abort
+
+// ---------------- Dosing profiles ----------------
+// Each slot keeps its own setpoint, overshoot table, latency and pulse model.
+// Long-press start to pick one (encoder turns, click/start confirms);
+// long-press start again while picking to clear that profile's learned table.
+constexpr uint8_t  PROFILE_COUNT     = 4;
+constexpr uint8_t  PROFILE_NAME_LEN  = 4;     // digits right of "P1"
+constexpr char     PROFILE_NAMES[PROFILE_COUNT][PROFILE_NAME_LEN + 1] = {
+    "ESP1", "ESP2", "FIL1", "FIL2"};
+constexpr float    PROFILE_SETPOINTS_G[PROFILE_COUNT] = {18.0f, 18.0f, 30.0f, 30.0f};
+constexpr uint32_t PROFILE_SELECT_MS = 4000;  // picker confirms itself after this
+
+// Trace recorder (one run of raw counts + relay edges, "t" on serial dumps it)
+constexpr uint16_t TRACE_MAX_EVENTS = 2048;  // ~25 s at 80 SPS
 
-// Learning of k_v (mg per g/s)
-constexpr float KV_EMA_ALPHA   = 0.2f;      // 0..1; higher -> faster adaptation
-constexpr float V_MIN_GPS      = 0.15f;     // avoid division blow-up when learning (bursty grinder flow)
+// Telemetry ring (16-byte record per measuring sample, "b" on serial dumps
+// the last runs as binary for "program decode")
+constexpr uint16_t TELEMETRY_RECORDS = 2560;  // ~32 s at 80 SPS, 40 KB
+constexpr uint8_t  TELEMETRY_RUNS    = 8;     // runs kept at most
 
 // UI error debounce (avoid brief Err blips)
 constexpr uint32_t ERROR_DISPLAY_DEBOUNCE_MS = 250;
@@ -2,42 +2,142 @@
 #include <Arduino.h>
 
 #include "buttons.h"
+#include "cutoff_timer.h"
 #include "display.h"
 #include "encoder.h"
+#include "fast_cutoff.h"
+#include "flow_predictor.h"
+#include "latency.h"
+#include "profiles.h"
 #include "relay.h"
 #include "scale.h"
 #include "state.h"
+#include "stop_latch.h"
+#include "telemetry.h"
+#include "trace.h"
 
 class Controller {
    public:
+    enum class CutoffEngine : uint8_t {
+        FORMULA = 0,  // x + v*tau + a*tau^2/2 from the fast estimator
+        LSQ = 1,      // least-squares time-to-target (FlowPredictor)
+    };
+
+    // Cutoff/learning parameters that replay and tuning may override
+    struct Tuning {
+        CutoffEngine engine = (CutoffEngine)CUTOFF_ENGINE;
+        int32_t hysteresis_mg = HYSTERESIS_MG;
+        float ot_min_gain = OT_MIN_GAIN;
+        bool learn_tau = true;  // follow the measured actuator latency
+        uint8_t topup_pulses = TOPUP_MAX_PULSES;  // 0 disables top-up
+        int32_t topup_tol_mg = TOPUP_TOL_MG;
+        int32_t approach_mg = APPROACH_ZONE_MG;  // 0 disables duty cycling
+        bool cutoff_timer = CUTOFF_TIMER;  // relay off between samples
+        bool fast_cutoff = FAST_CUTOFF;    // relay off in the sampling task
+    };
+
     void begin(Scale* sc, Encoder* enc, Buttons* btn, Display* disp,
                Relay* rel);
     void update();
-    void setSetpointMg(int32_t mg) { setpoint_mg_ = mg; }
-    void setKvMgPerGps(float kv) { k_v_mg_per_gps_ = kv; }
-    int32_t setpointMg() const { return setpoint_mg_; }
+    void setSetpointMg(int32_t mg) { profiles_.active().setpoint_mg = mg; }
+    void setTuning(const Tuning& t) { tuning_ = t; }
+    const Tuning& tuning() const { return tuning_; }
+    // Record each run (raw counts + relay edges) into rec; nullptr disables
+    void setTraceRecorder(TraceRecorder* rec) { trace_ = rec; }
+    // Record every measuring sample into log; nullptr disables
+    void setTelemetry(TelemetryLog* log) { telem_ = log; }
+    int32_t setpointMg() const { return profiles_.active().setpoint_mg; }
+    // Dosing profiles (setpoint, overshoot table); load before begin()
+    ProfileStore& profiles() { return profiles_; }
+    const ProfileStore& profiles() const { return profiles_; }
+    // Learned overshoot correction of the active profile
+    OvershootTable& overshoot() { return profiles_.active().ot; }
+    const OvershootTable& overshoot() const { return profiles_.active().ot; }
+    // Learned switch-off latency of the relay's actuator; load before begin()
+    LatencyEstimate& latency() { return tau_; }
+    const LatencyEstimate& latency() const { return tau_; }
+    AppState state() const { return state_; }
+    // Relay-off time (monoUs()) of the last run
+    uint64_t cutoffUs() const { return cutoff_us_; }
+    // Sample-to-relay-off latency of recent automatic stops
+    const CutoffLatencyLog& cutoffLatency() const { return cut_lat_; }
+    // Top-up pulses fired after the last run
+    uint8_t topUpPulses() const { return topup_n_; }
+    // Samples lost to ring overflow (seq gaps) since boot
+    uint32_t missedSamples() const { return missed_samples_; }
 
    private:
+    bool cutoffReached(const Scale::Sample& s) const;
+    int32_t remainingMg(const Scale::Sample& s) const;
+    float stopFlowMgps(float v_mgps) const;
+    void updateApproach();
+    bool cutoffReachedLsq() const;
+    float lsqTargetMg(const FlowPredictor::Fit& f) const;
+    float latencyMassMg() const;
+    void trackFlow(const Scale::Sample& s);
+    void stopRun(float v_stop_gps, bool timed_out, uint64_t sample_us);
+    uint64_t relayOff(uint64_t sample_us);
+    void armFastCutoff(float lead_mg);
+    float leadMg(float v_mgps) const;
+    void scheduleCutoff(const Scale::Sample& s);
+    void stopTimed();
+    void updateTopUp();
+    void endTopUp();
+    void startTrace();
+    void startTelemetry();
+    void confirmProfile();
+    int32_t hxCounts(const Scale::Sample& s) const;
+    int32_t sampleMg(const Scale::Sample& s) const;
+
     Scale* sc_ = nullptr;
     Encoder* enc_ = nullptr;
     Buttons* btn_ = nullptr;
     Display* disp_ = nullptr;
     Relay* rel_ = nullptr;
+    TraceRecorder* trace_ = nullptr;
+    TelemetryLog* telem_ = nullptr;
+    Tuning tuning_;
+    FlowPredictor flow_;  // fed with every sample while measuring
+    float flow_avg_mgps_ = 0.0f;   // v averaged over TAU_FLOW_AVG_MS
+    uint64_t flow_avg_t_us_ = 0;   // its last sample
+    uint32_t sample_dt_us_ = 0;    // spacing of the last two samples
+    DecayOnsetProbe onset_;        // flow decay after the last automatic stop
+    StopLatch stop_latch_;         // one stop per run for the two below
+    FastCutoff fast_cut_;          // relay off in the sampling task
+    CutoffTimer cutoff_timer_;     // relay off between samples
+    uint64_t plan_at_us_ = 0;      // instant the timer is armed for
+    float plan_v_mgps_ = 0.0f;     // flow at the armed instant
+    uint64_t cutoff_us_ = 0;
+    CutoffLatencyLog cut_lat_;
+    bool approach_ = false;        // duty cycling the relay near the target
+    bool approach_on_ = false;     // relay state within the duty cycle
+    uint64_t approach_t0_us_ = 0;  // start of the first period
     AppState state_ = AppState::IDLE;
-    int32_t setpoint_mg_ = 14000;  // default 14.0 g
+    uint8_t picked_ = 0;  // profile shown while in PROFILE_SELECT
+    bool setpoint_dirty_ = false;  // turned since the last profile save
 
-    uint32_t tShowUntil_ = 0;
-    uint32_t tMeasureUntil_ = 0;
-    uint32_t tMeasureDoneUntil_ = 0;
-    uint32_t tCalDoneUntil_ = 0;
+    // deadlines on the monoUs() timebase
+    uint64_t tShowUntil_ = 0;
+    uint64_t tMeasureUntil_ = 0;
+    uint64_t tMeasureDoneUntil_ = 0;
+    uint64_t tCalDoneUntil_ = 0;
     bool done_from_cal_ = false;
     bool stopped_manually_ = false;
     bool timed_out_ = false;
+    uint32_t last_seq_ = 0;  // last sample consumed from the scale
+    uint32_t missed_samples_ = 0;
 
-    // Learned spin-down coefficient (mg per g/s)
-    float k_v_mg_per_gps_ = 0.0f;
+    // Setpoint and learned overshoot per dosing profile
+    ProfileStore profiles_;
+    LatencyEstimate tau_;  // shared by the profiles: it is the actuator's
     float last_v_stop_gps_ = 0.0f;
 
-    // display throttle
-    uint32_t tDispNext_ = 0;
+    // top-up after an under-dose
+    uint8_t topup_n_ = 0;          // pulses fired this run
+    uint32_t topup_len_ms_ = 0;    // length of the last pulse
+    int32_t topup_from_mg_ = 0;    // settled mass before it (run's end at first)
+    float topup_flow_mgps_ = 0.0f; // run's averaged flow, sizes the first pulse
+    bool topup_learned_ = false;   // pulse model changed, save at the end
+    uint64_t tTopUpMin_ = 0;       // settle: earliest reading / pulse: off
+    uint64_t tTopUpUntil_ = 0;     // settle: give up
 };
@@ -0,0 +1,43 @@
+#pragma once
+#include <esp_timer.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "relay.h"
+#include "stop_latch.h"
+
+// One-shot relay-off between two conversions.
+//
+// The cutoff condition is only evaluated when a sample arrives, which
+// quantizes the stop to the 12.5 ms sample period (25-45 mg at 2-3.5 g/s).
+// The controller extrapolates when the target will be crossed and arms this
+// timer for that instant; the esp_timer task then switches the relay off
+// without waiting for loop(). Every new sample re-arms or cancels it.
+class CutoffTimer {
+   public:
+    bool begin(Relay* rel, StopLatch* latch);
+
+    // Switch the relay off at at_us (monoUs()); replaces a pending shot,
+    // no effect once this run's stop was claimed (by either path)
+    void arm(uint64_t at_us);
+    // No effect once the shot has fired
+    void cancel();
+    bool armed() const { return armed_; }
+
+    // The relay was switched off by the timer, at firedUs()
+    bool fired() const { return fired_.load(std::memory_order_acquire); }
+    uint64_t firedUs() const { return fired_us_; }
+    // The controller has taken over the stop
+    void clear();
+
+   private:
+    static void onFire(void* self);
+
+    Relay* rel_ = nullptr;
+    StopLatch* latch_ = nullptr;
+    esp_timer_handle_t timer_ = nullptr;
+    bool armed_ = false;              // loop() side only
+    uint64_t fired_us_ = 0;           // written before fired_ is published
+    std::atomic<bool> fired_{false};  // set from the esp_timer task
+};
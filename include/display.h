@@ -2,11 +2,50 @@
 #include <Arduino.h>
 #include <LedControl.h>
 
+#include "config.h"
+#include "ring.h"
+
 class Display {
    public:
+    // What the controller wants on screen. Published as a whole and rendered
+    // by the display task, so the control path never waits on the bus.
+    struct View {
+        enum class Mode : uint8_t {
+            WEIGHT = 0,
+            SETPOINT,
+            PROFILE,
+            ERROR,
+            CAL_SPAN,
+            CAL_DONE,
+            HINT_HOLD,
+            KV_RESET
+        };
+        Mode mode = Mode::WEIGHT;
+        bool stable = false;
+        bool measuring = false;  // selects DISPLAY_MEAS_MS over DISPLAY_IDLE_MS
+        uint8_t profile = 0;     // PROFILE: 1-based number
+        char name[PROFILE_NAME_LEN + 1] = {};  // PROFILE: name
+        int32_t weight_mg = 0;
+        int32_t setpoint_mg = 0;
+        // Status module (DISPLAY_MODULES > 1), shown while measuring
+        int32_t flow_mgps = 0;
+        int32_t eta_ms = -1;  // time to the setpoint, -1 unknown
+    };
+
     void begin(uint8_t din, uint8_t clk, uint8_t cs);
+    // Starts the task that renders published views at the display frame
+    // rate; until then (and without it) the show*() calls draw directly
+    void startTask();
+    // Lock-free; the newest view wins, older unrendered ones are dropped
+    void publish(const View& v) { views_.publish(v); }
+    // Renders the newest view from the caller when there is no task,
+    // throttled to the frame rate
+    void update();
+
     void showWeightMg(int32_t mg, bool stable);
     void showSetpointMg(int32_t mg);
+    // "P<n>" and the profile name, e.g. "P1  ESP1"
+    void showProfile(uint8_t number, const char* name);
     void showError();
     void showCalZero();
     void showCalSpan();
@@ -20,8 +59,28 @@ class Display {
 
    private:
     LedControl lc_{-1, -1, -1, 1};
+    LatestValue<View> views_;
+    TaskHandle_t task_ = nullptr;
+    uint64_t next_frame_us_ = 0;  // update() only
+    bool measuring_ = false;      // of the last view rendered
+    static void taskThunk(void* arg);
+    // Renders the newest view if there is one; returns the frame period
+    uint32_t renderLatest();
+    void render(const View& v);
+    // Frame being composed, one segment byte per MAX7219 digit register,
+    // 8 per module in chain order
+    uint8_t fb_[8 * DISPLAY_MODULES] = {};
+    // Status module content, drawn into every frame by beginFrame()
+    bool status_on_ = false;
+    int32_t flow_mgps_ = 0;
+    int32_t eta_ms_ = -1;
+    void renderStatus();
+    void renderTenths(uint8_t module, int pos, int width, int32_t tenths);
+    void beginFrame();
+    void flush();
     int mapDigit(int d) const;
     void putChar(int pos, char c, bool dp = false);
+    void putCharAt(uint8_t module, int pos, char c, bool dp = false);
     void putDigit(int pos, uint8_t d, bool dp = false);
     void renderNumberMg(int32_t mg);
 };
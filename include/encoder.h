@@ -11,6 +11,8 @@ class Encoder {
     void update();
     // Returns and clears accumulated delta (mg) since last call
     int32_t consumeDeltaMg();
+    // Returns and clears whole detents (signed) since last call; for menus
+    int32_t consumeDetents();
     // Button edges
     bool buttonShortPress();
     bool buttonLongPress();
@@ -20,6 +22,7 @@ class Encoder {
     uint8_t pa_ = 255, pb_ = 255, psw_ = 255;
     uint8_t prev_ = 0;
     int32_t delta_mg_ = 0;
-    uint32_t lastTickMs_ = 0;
+    int32_t steps_ = 0;  // quadrature transitions not yet consumed as detents
+    uint64_t lastTickUs_ = 0;  // monoUs of last detent
     float emaDt_ = 0.05f;
 };
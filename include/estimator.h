@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+
+// Fast weight/flow estimators for the cutoff prediction. Both take one
+// measurement z (mg) with the time since the previous one (us) and expose
+// position x (mg), velocity v (mg/s) and acceleration a (mg/s^2).
+// Scale::FastEstimator picks one at compile time (SCALE_ESTIMATOR_KALMAN).
+//
+// dt is nearly constant within a sampling mode, so every dt-dependent
+// coefficient (reciprocals, Kalman gains) is looked up in a small table keyed
+// by the dt bucket and only computed when a new bucket shows up. The
+// per-sample update is then multiply/add only: no division, no sqrtf.
+
+// dt bucket width (us) and table slots (direct-mapped by bucket)
+constexpr uint32_t EST_DT_BUCKET_SHIFT = 7;  // 128 us
+constexpr uint32_t EST_DT_SLOTS = 4;
+
+// Fixed-gain α–β filter on (x, v); acceleration is an EMA of dv/dt
+class AlphaBetaEstimator {
+   public:
+    void setGains(float g, float h);
+    void update(float z, uint32_t dt_us);
+
+    float x() const { return x_; }
+    float v() const { return v_; }
+    float a() const { return a_; }
+
+   private:
+    struct Coef {
+        uint32_t bucket = UINT32_MAX;
+        float dt;         // s
+        float h_dt;       // h / dt
+        float ema_a_dt;   // 0.2 / dt (accel EMA weight on dv)
+    };
+    const Coef& coef(uint32_t dt_us);
+
+    float x_ = 0.0f, v_ = 0.0f, a_ = 0.0f;
+    float last_v_ = 0.0f;
+    float g_ = 0.4f;   // α gain (0..1)
+    float h_ = 0.08f;  // β gain (~0..1)
+    Coef tab_[EST_DT_SLOTS];
+    const Coef* last_ = tab_;
+};
+
+// Constant-acceleration Kalman filter on (x, v, a) driven by white jerk,
+// full covariance propagation with F and Q built from each sample's dt.
+// Used as the reference and to derive the steady-state gains below.
+class KalmanCaFull {
+   public:
+    struct Noise {
+        float q_jerk;  // jerk spectral density, (mg/s^3)^2 per Hz
+        float r_mg2;   // measurement variance, mg^2
+    };
+
+    void setNoise(const Noise& n) { n_ = n; }
+    void update(float z, uint32_t dt_us);
+
+    float x() const { return s_[0]; }
+    float v() const { return s_[1]; }
+    float a() const { return s_[2]; }
+
+    // Steady-state gain for a fixed dt (Riccati recursion to convergence)
+    static void steadyGain(const Noise& n, float dt, float K[3]);
+
+   private:
+    void init(float z);
+    void predictCov(float dt);
+    void gain(float K[3]);
+    void updateCov(const float K[3]);
+
+    Noise n_ = {0.0f, 1.0f};
+    float s_[3] = {0.0f, 0.0f, 0.0f};
+    float P_[3][3] = {};
+    bool init_ = false;
+};
+
+// Constant-acceleration Kalman filter running on its steady-state gains
+// (an α–β–γ filter with per-dt optimal gains) — the covariance only matters
+// for the first few samples, so it is not carried per sample.
+class KalmanCaEstimator {
+   public:
+    using Noise = KalmanCaFull::Noise;
+
+    // Invalidates the gain table when the noise actually changes
+    void setNoise(const Noise& n);
+    void update(float z, uint32_t dt_us);
+
+    float x() const { return s_[0]; }
+    float v() const { return s_[1]; }
+    float a() const { return s_[2]; }
+
+   private:
+    struct Coef {
+        uint32_t bucket = UINT32_MAX;
+        float dt;      // s
+        float half_dt2;
+        float K[3];
+    };
+    const Coef& coef(uint32_t dt_us);
+
+    Noise n_ = {0.0f, 1.0f};
+    float s_[3] = {0.0f, 0.0f, 0.0f};
+    bool init_ = false;
+    Coef tab_[EST_DT_SLOTS];
+    const Coef* last_ = tab_;
+};
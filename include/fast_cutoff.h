@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+#include <atomic>
+
+#include "relay.h"
+#include "stop_latch.h"
+
+// Formula cutoff evaluated in the sampling context.
+//
+// Scale calls check() right after the estimator update of every sample, so
+// a met condition switches the relay off before the sample is even queued
+// for loop(). The controller re-arms the threshold after each sample it
+// consumes: setpoint - hysteresis - actuator latency mass - learned
+// correction, all of which change slowly. The sample-dependent part,
+// x + v*tau + a*tau^2/2 over TAU_MEAS_MS, is added here.
+class FastCutoff {
+   public:
+    void begin(Relay* rel, StopLatch* latch) {
+        rel_ = rel;
+        latch_ = latch;
+    }
+
+    // No effect once this run's stop was claimed (by either path)
+    void arm(float threshold_mg) {
+        if (latch_->claimed()) return;
+        threshold_mg_.store(threshold_mg, std::memory_order_relaxed);
+        armed_.store(true, std::memory_order_release);
+    }
+    void disarm() { armed_.store(false, std::memory_order_release); }
+
+    // Sampling context: switch the relay off if the sample meets the
+    // threshold and the stop is not claimed yet; true if it did
+    bool check(uint32_t seq, uint64_t t_us, float x_mg, float v_mgps,
+               float a_mgps2);
+
+    // The relay was switched off on sample firedSeq(), firedUs() after its
+    // DRDY edge took firedLatencyUs()
+    bool fired() const { return fired_.load(std::memory_order_acquire); }
+    uint32_t firedSeq() const { return fired_seq_; }
+    uint64_t firedUs() const { return fired_us_; }
+    uint32_t firedLatencyUs() const { return fired_lat_us_; }
+    // The controller has taken over the stop
+    void clear() { fired_.store(false, std::memory_order_relaxed); }
+
+   private:
+    Relay* rel_ = nullptr;
+    StopLatch* latch_ = nullptr;
+    std::atomic<float> threshold_mg_{0.0f};
+    std::atomic<bool> armed_{false};
+    // written before fired_ is published
+    uint32_t fired_seq_ = 0;
+    uint64_t fired_us_ = 0;
+    uint32_t fired_lat_us_ = 0;
+    std::atomic<bool> fired_{false};
+};
+
+// Sample-to-relay-off latency of the last kKeep automatic stops per path,
+// reported as percentiles on the serial 'l' command
+class CutoffLatencyLog {
+   public:
+    enum Path : uint8_t {
+        FAST = 0,  // sampling context, DRDY -> relay off
+        LOOP,      // loop() on the sample, DRDY -> relay off
+        TIMER,     // cutoff timer, armed instant -> relay off
+        kPaths
+    };
+    static constexpr uint8_t kKeep = 64;
+
+    void record(Path p, uint32_t us);
+    // Percentiles (us) of the kept stops of one path; false if none yet
+    bool percentiles(Path p, uint32_t& p50, uint32_t& p90, uint32_t& p99,
+                     uint32_t& max, uint8_t& n) const;
+
+   private:
+    uint32_t us_[kPaths][kKeep] = {};
+    uint8_t n_[kPaths] = {};
+    uint8_t next_[kPaths] = {};
+};
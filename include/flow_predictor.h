@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+#include "config.h"
+
+// Quadratic least-squares fit over the last FLOW_FIT_SAMPLES fast samples,
+// used to predict when the dose reaches its target.
+//
+// Conversions arrive on the HX711's own clock, so the fit runs on sample
+// index j (0 = newest, -1, -2, ...) and only converts to seconds at the end
+// using the window's measured span. With a fixed index grid the moments of j
+// are constants (inverse normal matrix precomputed), and the data moments
+// Σy, Σjy, Σj²y slide in O(1) exact integer steps: re-indexing after a push
+// is Σ(j-1)y = Σjy - Σy and Σ(j-1)²y = Σj²y - 2Σjy + Σy. A gap in the
+// sample stream breaks the grid, so the window restarts.
+class FlowPredictor {
+   public:
+    static constexpr uint32_t kN = FLOW_FIT_SAMPLES;
+
+    // Fit evaluated at the newest sample: y(τ) = m + v τ + a τ²/2, τ in s
+    struct Fit {
+        float m;  // mg
+        float v;  // mg/s
+        float a;  // mg/s^2
+        float at(float tau) const { return m + (v + 0.5f * a * tau) * tau; }
+    };
+
+    FlowPredictor();
+    void reset();
+    void push(uint64_t t_us, int32_t mg);
+    bool ready() const { return n_ == kN; }
+
+    Fit fit() const;
+    // Fit reaches target_mg within the next horizon_s (no sqrt)
+    static bool reachesWithin(const Fit& f, float target_mg, float horizon_s);
+    // Seconds until the fit reaches target_mg; INFINITY if it never does
+    static float timeTo(const Fit& f, float target_mg);
+
+   private:
+    int32_t y_[kN];
+    uint32_t t_[kN];  // low 32 bits of the sample times
+    uint32_t head_ = 0, n_ = 0;
+    uint32_t last_us_ = 0;
+    int64_t s0_ = 0, s1_ = 0, s2_ = 0;  // Σy, Σjy, Σj²y
+    int64_t sj_[3];                     // Σ1, Σj, Σj² over a full window
+    float inv_[3][3];                   // (Σ j^(r+c))^-1 over a full window
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+
+struct spi_device_t;
+struct spi_transaction_t;
+
+// Native HX711 driver. The 24-bit conversion plus the gain/channel pulses are
+// clocked out by the SPI master peripheral (DT = MISO, SCK = SCLK), so a read
+// is one queued transaction instead of 25..27 bit-banged pulses with
+// busy-waits. The caller starts a readout and collects it later (or blocks on
+// the SPI interrupt from a task) without spinning on the CPU.
+class Hx711 {
+   public:
+    // Channel/gain used for the *next* conversion; the value is the number of
+    // extra SCK pulses after the 24 data bits (datasheet table 3)
+    enum class Gain : uint8_t { A128 = 1, B32 = 2, A64 = 3 };
+
+    // Claims the SPI host and pins; returns false if the bus is unavailable
+    bool begin(uint8_t dtPin, uint8_t sckPin, Gain gain = Gain::A128);
+
+    // Takes effect from the next conversion; readout after this one applies it
+    void setGain(Gain g) { gain_ = g; }
+    Gain gain() const { return gain_; }
+
+    // DOUT low means a conversion is waiting
+    bool isReady() const;
+
+    // Queue the readout of the pending conversion. Returns false if the
+    // driver is not initialized or a readout is already in flight.
+    bool startRead();
+
+    // Collect a started readout. waitTicks = 0 polls without blocking; a task
+    // may pass portMAX_DELAY to sleep until the SPI interrupt completes it.
+    bool completeRead(int32_t& out, uint32_t waitTicks = 0);
+
+    // Blocking convenience for setup code and benchmarks
+    bool read(int32_t& out);
+
+    bool busy() const { return busy_; }
+
+   private:
+    spi_device_t* dev_ = nullptr;
+    spi_transaction_t* trans_ = nullptr;
+    uint8_t dt_pin_ = 0;
+    uint8_t sck_pin_ = 0;
+    Gain gain_ = Gain::A128;
+    bool busy_ = false;
+};
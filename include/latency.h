@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+
+#include "config.h"
+
+// Measures the actuator latency on each automatic stop: the time from the
+// relay-off command until the flow seen by the scale starts to fall.
+//
+// Until then the flow stays at the running rate; once the motor has lost
+// power and the last full-rate grounds have landed it decays as the motor
+// coasts down. The flow here is a centred difference of the unfiltered
+// readings over 2 * TAU_ONSET_SPAN samples: it is looked at after the fact,
+// so unlike the estimator's v it does not lag. The decay is taken from
+// where that flow last fell through TAU_ONSET_HI and then through
+// TAU_ONSET_LO of the flow at the stop: the line through the two crossings,
+// extended back to the full flow, marks the onset. The mass of the
+// coast-down tail after it is left to the overshoot table.
+class DecayOnsetProbe {
+   public:
+    static constexpr uint8_t kWindow = 2 * TAU_ONSET_SPAN + 1;
+
+    // Relay switched off at off_us (monoUs()) with the flow at v_ref_mgps
+    void begin(uint64_t off_us, float v_ref_mgps);
+    void cancel() { v_ref_ = 0.0f; }
+    // Still waiting for the decay
+    bool active() const { return v_ref_ > 0.0f && !done_; }
+    // Every fast sample after the command (DRDY time, unfiltered mass)
+    void feed(uint64_t t_us, int32_t mg);
+    float vRef() const { return v_ref_; }
+    // Latency (ms) from the onset; false if none was seen in time
+    bool measureMs(float& ms) const;
+
+   private:
+    void flowAt(float t_ms, float v_mgps);
+
+    uint64_t off_us_ = 0;
+    float v_ref_ = 0.0f;      // mg/s
+    float t_ms_[kWindow];     // last readings, ms after the command
+    int32_t mg_[kWindow];
+    uint8_t n_ = 0;           // readings seen (saturates at kWindow)
+    uint8_t head_ = 0;        // oldest reading
+    float prev_ms_ = 0.0f;    // previous flow point
+    float prev_v_ = 0.0f;
+    float hi_ms_ = -1.0f;     // last fall through TAU_ONSET_HI, < 0 if none
+    float ms_ = -1.0f;        // measured latency, < 0 until the decay
+    bool done_ = false;
+};
+
+// Running actuator latency (tau_comm) with a robust update: residuals are
+// clipped at TAU_HUBER_K mean deviations, so a single slow HTTP round trip
+// or a chute clump only nudges the estimate. The TAU_COMM_MS default counts
+// as one measurement, so the first real one moves it halfway.
+struct LatencyEstimate {
+    float ms = TAU_COMM_MS;  // used in the cutoff offset
+    float dev_ms = 0.0f;     // mean absolute deviation of measurements
+    uint8_t runs = 0;        // measurements folded in (saturates)
+
+    void reset() { *this = LatencyEstimate(); }
+    void learn(float measured_ms);
+};
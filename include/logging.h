@@ -0,0 +1,154 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <type_traits>
+
+#include "config.h"
+
+// Non-blocking logging.
+//
+// A log call copies its format pointer and arguments into a binary record
+// in a lock-free queue and returns; it never formats, never waits for the
+// UART and never blocks: a full queue drops the record and counts it. A
+// low-priority task on the other core (or update() from loop() if it cannot
+// be created) formats the records and writes them to Serial.
+//
+// Calls below LOG_LEVEL_COMPILED or outside LOG_MODULES_COMPILED compile to
+// nothing; the rest are filtered at runtime per module (setLevel()).
+//
+//     LOGF(INFO, STORAGE, "Persist %s = %ld (new)", key, (long)value);
+//
+// The format must be a string literal (only its pointer is queued). String
+// arguments are copied into the record, up to kTextLen bytes in total per
+// record. No trailing newline: every record is one line.
+namespace logging {
+
+enum class Level : uint8_t { ERROR = 0, WARN, INFO, DEBUG };
+enum class Module : uint8_t {
+    MAIN = 0,
+    CTRL,
+    SCALE,
+    ENCODER,
+    DISPLAY,
+    STORAGE,
+    SWITCH,
+    COUNT
+};
+
+constexpr uint8_t kMaxArgs = 6;
+constexpr uint8_t kTextLen = 32;
+
+struct Record {
+    enum Type : uint8_t { INT, UINT, DOUBLE, STR };
+    const char* fmt;
+    uint32_t t_ms;
+    Level level;
+    Module module;
+    uint8_t nargs;
+    uint8_t text_used;
+    uint8_t type[kMaxArgs];
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } arg[kMaxArgs];
+    char text[kTextLen];  // string arguments, NUL-separated
+};
+
+constexpr bool compiled(Level l, Module m) {
+    return (uint8_t)l <= LOG_LEVEL_COMPILED &&
+           (LOG_MODULES_COMPILED >> (uint8_t)m & 1u);
+}
+
+// Starts the drain task; records queued before are kept
+void begin();
+// Drains the queue from the caller when there is no drain task
+void update();
+
+// Keep Serial to the caller while it writes a dump that must not be split
+// by a log line (binary frames, the replay trace). pause() returns once a
+// drain pass in progress has finished; records queue meanwhile, or drop
+// when the queue fills. resume() flushes them.
+void pause();
+void resume();
+
+// Runtime filter: records above the level are discarded at the call
+void setLevel(Level l);  // all modules
+void setLevel(Module m, Level l);
+Level level(Module m);
+bool enabled(Level l, Module m);
+
+// Records dropped because the queue was full, since boot
+uint32_t dropped();
+
+// ---- used by LOGF ----
+Record* claim(Level l, Module m, const char* fmt, uint32_t& ticket);
+void publish(uint32_t ticket);
+
+inline void put(Record& r, const char* s) {
+    if (!s) s = "(null)";
+    uint8_t at = r.text_used;
+    size_t room = kTextLen - at;
+    size_t n = room ? strnlen(s, room - 1) : 0;
+    if (room) {
+        memcpy(r.text + at, s, n);
+        r.text[at + n] = '\0';
+        r.text_used = at + n + 1;
+    }
+    r.type[r.nargs] = Record::STR;
+    r.arg[r.nargs].u = room ? at : kTextLen;  // kTextLen: did not fit
+}
+inline void put(Record& r, char* s) { put(r, (const char*)s); }
+template <typename T>
+void put(Record& r, T v) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                      std::is_pointer<T>::value,
+                  "log arguments must be numbers, enums, pointers or strings");
+    if constexpr (std::is_floating_point<T>::value) {
+        r.type[r.nargs] = Record::DOUBLE;
+        r.arg[r.nargs].d = (double)v;
+    } else if constexpr (std::is_pointer<T>::value) {
+        r.type[r.nargs] = Record::UINT;
+        r.arg[r.nargs].u = (uint64_t)(uintptr_t)v;
+    } else if constexpr (std::is_signed<T>::value) {
+        r.type[r.nargs] = Record::INT;
+        r.arg[r.nargs].i = (int64_t)v;
+    } else {
+        r.type[r.nargs] = Record::UINT;
+        r.arg[r.nargs].u = (uint64_t)v;
+    }
+}
+
+inline void capture(Record&) {}
+template <typename T, typename... Rest>
+void capture(Record& r, T v, Rest... rest) {
+    put(r, v);
+    r.nargs++;
+    capture(r, rest...);
+}
+
+template <typename... A>
+void write(Level l, Module m, const char* fmt, A... a) {
+    static_assert(sizeof...(A) <= kMaxArgs, "too many log arguments");
+    if (!enabled(l, m)) return;
+    uint32_t ticket;
+    Record* r = claim(l, m, fmt, ticket);
+    if (!r) return;
+    capture(*r, a...);
+    publish(ticket);
+}
+
+// Formats one record into out (no newline), as the drain task does
+size_t format(const Record& r, char* out, size_t len);
+
+}  // namespace logging
+
+#define LOGF(level, module, fmt, ...)                                        \
+    do {                                                                     \
+        if (logging::compiled(logging::Level::level,                         \
+                              logging::Module::module))                      \
+            logging::write(logging::Level::level, logging::Module::module,   \
+                           fmt, ##__VA_ARGS__);                              \
+    } while (0)
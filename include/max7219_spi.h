@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct spi_device_t;
+struct spi_transaction_t;
+
+// MAX7219 chain on an ESP32 SPI host. Every register write (one 16-bit word
+// per device in the chain, latched by the rising edge of CS) is a queued DMA
+// transaction with hardware CS, so the caller returns as soon as it is
+// queued and a whole frame goes out while loop() carries on. Used by
+// LedControl when it is given an SPI host; the pins are routed through the
+// GPIO matrix, so any output-capable pins work.
+class Max7219Spi {
+   public:
+    // Bytes per write: 2 per device in the chain (at most kMaxBytes)
+    static constexpr uint8_t kMaxBytes = 16;
+    // Writes that may be in flight before write() has to wait
+    static constexpr uint8_t kSlots = 16;
+
+    Max7219Spi() = default;
+    ~Max7219Spi() { end(); }
+    // Owns the bus device and the DMA buffers
+    Max7219Spi(const Max7219Spi&) = delete;
+    Max7219Spi& operator=(const Max7219Spi&) = delete;
+
+    // Claims the SPI host and pins; returns false if the bus is unavailable
+    bool begin(int host, int dinPin, int clkPin, int csPin, uint8_t bytes);
+
+    // Queues one write, bytes in wire order. Blocks only when kSlots writes
+    // are still in flight.
+    bool write(const uint8_t* bytes);
+
+    // Waits for the writes in flight, then gives the host and pins back.
+    // Does nothing if begin() did not succeed.
+    void end();
+
+   private:
+    void release();
+
+    int host_ = -1;
+    spi_device_t* dev_ = nullptr;
+    spi_transaction_t* trans_ = nullptr;  // kSlots
+    uint8_t* buf_ = nullptr;              // kSlots * kMaxBytes, DMA-capable
+    uint8_t len_ = 0;
+    uint8_t next_ = 0;      // slot the next write goes into
+    uint8_t inflight_ = 0;  // queued writes not yet collected
+};
@@ -0,0 +1,72 @@
+#pragma once
+// Host stand-in for the subset of the Arduino-ESP32 API the firmware uses.
+// Implemented by src/native/hal_native.cpp on top of hal_native.h.
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(int pin, void (*isr)(), int mode);
+void detachInterrupt(int pin);
+
+class HardwareSerial {
+   public:
+    void begin(unsigned long) {}
+    explicit operator bool() const { return true; }
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* s);
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(double v) { return printf("%.2f", v); }
+    template <typename T>
+    size_t println(T v) {
+        return print(v) + println();
+    }
+    size_t println() { return print("\r\n"); }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t n);
+    void flush() {}
+};
+extern HardwareSerial Serial;
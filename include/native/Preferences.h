@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the ESP32 NVS Preferences API, kept in memory
+// (hal::kvClear() wipes it).
+class Preferences {
+   public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() {}
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+    int32_t getInt(const char* key, int32_t def = 0);
+    size_t putInt(const char* key, int32_t v);
+    float getFloat(const char* key, float def = 0.0f);
+    size_t putFloat(const char* key, float v);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t putBytes(const char* key, const void* buf, size_t len);
+
+   private:
+    char ns_[16] = {0};
+};
@@ -0,0 +1,4 @@
+#pragma once
+// Pre-1.0 Arduino header name; LedControl.h falls back to it when ARDUINO is
+// not defined, which is the case on the host.
+#include "Arduino.h"
@@ -0,0 +1,25 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*,
+                                          uint32_t, void*, UBaseType_t,
+                                          TaskHandle_t* handle, BaseType_t) {
+    if (handle) *handle = nullptr;
+    return pdFAIL;
+}
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name,
+                              uint32_t stack, void* arg, UBaseType_t prio,
+                              TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, 0);
+}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) {
+    if (woken) *woken = pdFALSE;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+// Tasks are never created here, so nothing calls this from a task body
+inline void vTaskDelay(TickType_t) {}
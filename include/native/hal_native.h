@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+// Host (env:native) backend of the hardware abstraction. The firmware keeps
+// calling the framework API it uses on the ESP32 (millis/esp_timer, GPIO,
+// Hx711, LedControl -> shiftOut, Preferences); on Linux those calls land
+// here. The functions below let a harness drive that virtual hardware.
+namespace hal {
+
+// ---- Time: virtual monotonic clock behind millis()/esp_timer_get_time() ----
+uint64_t nowUs();
+// Move the clock forward, firing due DRDY edges at their exact timestamps
+void advanceToUs(uint64_t t_us);
+inline void advanceUs(uint64_t dt_us) { advanceToUs(nowUs() + dt_us); }
+
+// ---- GPIO ----
+// Drive an input pin (buttons, encoder); unset inputs read HIGH (pull-ups)
+void setInput(uint8_t pin, int level);
+// Last level written to an output pin
+int output(uint8_t pin);
+// Called on every output level change (relay edges for recorders/sims)
+using PinListener = void (*)(uint8_t pin, int level, uint64_t t_us, void* ctx);
+void onOutputChange(PinListener fn, void* ctx);
+
+// ---- Load cell: feeds Hx711 and raises DRDY on its data pin ----
+class LoadCellSource {
+   public:
+    virtual ~LoadCellSource() = default;
+    // Time of the next conversion; false if the source is exhausted
+    virtual bool nextAt(uint64_t& t_us) = 0;
+    // Consume that conversion (24-bit signed counts)
+    virtual int32_t take() = 0;
+};
+void attachLoadCell(LoadCellSource* src, uint8_t dtPin);
+LoadCellSource* loadCell();
+void loadCellConsumed();  // native Hx711: conversion taken, re-arm DRDY
+
+// ---- Display sink: decoded MAX7219 register writes from LedControl ----
+class DisplaySink {
+   public:
+    virtual ~DisplaySink() = default;
+    virtual void write(uint8_t device, uint8_t reg, uint8_t value) = 0;
+};
+void attachDisplay(DisplaySink* sink, uint8_t csPin);
+
+// ---- Serial / key-value storage ----
+void setSerialEcho(bool on);  // Serial output to stdout (default on)
+void setSerialFile(FILE* f);  // send Serial output to f instead (nullptr: stdout)
+void kvClear();               // forget everything stored via Preferences
+
+}  // namespace hal
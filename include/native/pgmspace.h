@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte_near(addr) (*(const uint8_t*)(addr))
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// Learned overshoot correction (mg) by stop-time flow rate and setpoint band.
+//
+// Flow bins are spread evenly over OT_FLOW_MIN_GPS..OT_FLOW_MAX_GPS and read
+// with linear interpolation; setpoint bands (OT_SP_EDGES_G) are separate
+// rows. Each bin carries a confidence (accumulated learning weight): a new
+// bin takes the whole observed error, a well-known one averages it in, down
+// to a floor rate (OT_MIN_GAIN) so it keeps tracking beans and grind. Bins
+// without data borrow from the nearest learned bin.
+class OvershootTable {
+   public:
+    static constexpr uint8_t kBins = OT_FLOW_BINS;
+    static constexpr uint8_t kBands = OT_SP_BANDS;
+    // magic, version, bins, bands, then int16 mg + uint8 confidence per bin
+    static constexpr size_t kBlobSize = 5 + (size_t)kBins * kBands * 3;
+
+    void clear();
+    // Start from the old single k_v (mg per g/s): corr = k_v * flow
+    void seedFromKv(float kv_mg_per_gps);
+    // Calibration changed: keep the values, but let them re-adapt quickly
+    void weaken();
+    // The latency term grew by dtau_ms: take its flow-proportional share
+    // (flow * dtau) out of every learned bin so the total stays the same
+    void shiftForLatency(float dtau_ms);
+
+    // Correction to subtract from the setpoint (mg)
+    float lookup(float v_gps, int32_t setpoint_mg) const;
+    // Fold in the error of a finished run (final - setpoint, mg)
+    void learn(float v_gps, int32_t setpoint_mg, float eps_mg, float min_gain);
+
+    uint8_t learnedBins() const;
+    float binFlowGps(uint8_t bin) const;
+
+    // Compact NVS / trace form
+    void serialize(uint8_t out[kBlobSize]) const;
+    bool deserialize(const uint8_t* in, size_t len);
+
+   private:
+    static uint8_t band(int32_t setpoint_mg);
+    // bin index and interpolation fraction for a flow
+    static void locate(float v_gps, uint8_t& i, float& frac);
+    // value used for (band, bin): its own once learned, else nearest learned
+    float effective(uint8_t band, uint8_t bin) const;
+
+    float corr_[kBands][kBins] = {};
+    float conf_[kBands][kBins] = {};
+};
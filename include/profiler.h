@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// Cycle-count profiler for the named hot-path scopes.
+//
+// PROF_SCOPE(name) times the rest of the enclosing block with the CPU cycle
+// counter and folds it into that scope's min/max/mean and a histogram of
+// PROF_BUCKETS power-of-two buckets, all in fixed memory. Each scope is
+// entered from one task only, so recording needs no locks; scopes timed
+// in loop() include any preemption by the sampling task, which is what a
+// loop() iteration actually costs. The serial "p" command prints a report
+// and starts over. With PROFILER 0 the macro expands to nothing.
+namespace prof {
+
+enum class Scope : uint8_t {
+    LOOP = 0,   // one loop() iteration
+    HX_READ,    // HX711 word readout (sampling task)
+    ESTIMATOR,  // x/v/a estimator update (sampling task)
+    STABILITY,  // stability window (sampling task)
+    CUTOFF,     // sample consumption and cutoff decision (loop)
+    DISPLAY,    // display render (display task)
+    HID,        // encoder and buttons (loop)
+    NVS,        // preference writes
+    COUNT
+};
+
+#if PROFILER
+struct Stats {
+    uint32_t n = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t sum = 0;
+    uint32_t hist[PROF_BUCKETS] = {};
+};
+
+inline uint32_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();  // host build
+#else
+    return ESP.getCycleCount();
+#endif
+}
+
+void record(Scope s, uint32_t cycles);
+const Stats& stats(Scope s);
+// Table of all scopes that ran, then reset
+void report(HardwareSerial& out);
+
+class ScopeTimer {
+   public:
+    explicit ScopeTimer(Scope s) : s_(s), t0_(cycles()) {}
+    ~ScopeTimer() { record(s_, cycles() - t0_); }
+
+   private:
+    Scope s_;
+    uint32_t t0_;
+};
+#endif
+
+}  // namespace prof
+
+#if PROFILER
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+#define PROF_SCOPE(name) \
+    prof::ScopeTimer PROF_CONCAT(prof_scope_, __LINE__)(prof::Scope::name)
+#else
+#define PROF_SCOPE(name) \
+    do {                 \
+    } while (0)
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "overshoot_table.h"
+#include "topup.h"
+
+// One dosing setup (espresso/filter, bean): what the controller needs to
+// dose it without re-learning after a switch
+struct Profile {
+    char name[PROFILE_NAME_LEN + 1] = {};  // 7-segment friendly
+    int32_t setpoint_mg = 0;
+    OvershootTable ot;                     // learned overshoot correction
+    PulseModel pulse;                      // top-up pulse mass per ms
+};
+
+// Fixed set of PROFILE_COUNT named slots plus the active selection, stored
+// together as one NVS blob
+class ProfileStore {
+   public:
+    static constexpr uint8_t kCount = PROFILE_COUNT;
+    // name, setpoint int32, overshoot table blob, pulse mg/ms (uint16, 0.001)
+    // and pulse count
+    static constexpr size_t kRecordSize =
+        PROFILE_NAME_LEN + 4 + OvershootTable::kBlobSize + 2 + 1;
+    // magic, version, count, active, then kCount records
+    static constexpr size_t kBlobSize = 5 + kRecordSize * kCount;
+    // largest accepted blob: version 3 records also carried tau (2+2+1)
+    static constexpr size_t kMaxBlobSize = 5 + (kRecordSize + 5) * kCount;
+
+    ProfileStore() { reset(); }
+
+    // Names and setpoints from config, empty tables, first slot active
+    void reset();
+
+    Profile& active() { return p_[active_]; }
+    const Profile& active() const { return p_[active_]; }
+    uint8_t activeIndex() const { return active_; }
+    void select(uint8_t i) { active_ = i < kCount ? i : 0; }
+    Profile& at(uint8_t i) { return p_[i]; }
+    const Profile& at(uint8_t i) const { return p_[i]; }
+
+    void serialize(uint8_t out[kBlobSize]) const;
+    // also accepts versions 1-3, which kept a latency per profile: it is
+    // folded into the table, the latency is now learned per actuator
+    // (version 1: integer tau, no deviation; version 2: no pulse model)
+    bool deserialize(const uint8_t* in, size_t len);
+
+   private:
+    Profile p_[kCount];
+    uint8_t active_ = 0;
+};
@@ -1,9 +1,13 @@
 #pragma once
 #include <Arduino.h>
 
+// What switches the grinder; each kind has its own learned latency
+enum class Actuator : uint8_t { RELAY = 0, PLUG = 1 };
+
 class Relay {
    public:
     Relay() = default;
+    virtual ~Relay() = default;
 
     void begin() { count_ = 0; }
 
@@ -23,13 +27,23 @@ class Relay {
         writeAll(false);
     }
 
-    void set(bool on) {
+    // Virtual: the controller only holds a Relay*, WifiRelay must still see it
+    virtual void set(bool on) {
         on_ = on;
         writeAll(on);
     }
 
+    // Same without waiting, for the sampling and timer tasks; false if the
+    // command could not be issued right away (the caller repeats it later)
+    virtual bool trySet(bool on) {
+        set(on);
+        return true;
+    }
+
     bool isOn() const { return on_; }
 
+    virtual Actuator actuator() const { return Actuator::RELAY; }
+
    private:
     void writeAll(bool on) {
         const int level = on ? HIGH : LOW;
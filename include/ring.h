@@ -0,0 +1,194 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring of fixed-size records.
+//
+// The producer never overwrites records that are still unread, nor the last
+// HISTORY records the consumer has already popped, so the consumer can look
+// at both in place without copying or locking. When the ring is full the new
+// record is dropped and counted; records carry their own sequence numbers so
+// the consumer can also see the gap.
+template <typename T, uint32_t N, uint32_t HISTORY = 0>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0,
+                  "capacity must be a power of two");
+    static_assert(HISTORY < N, "history must leave room for new records");
+
+   public:
+    // ---- producer side ----
+    // Returns false (and counts a drop) if the consumer is too far behind
+    bool push(const T& v) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= N - HISTORY) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buf_[head & kMask] = v;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ---- consumer side ----
+    // Oldest unread record, or nullptr if empty. Valid until pop().
+    const T* front() const {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+        return &buf_[tail & kMask];
+    }
+
+    // Mark the front record as consumed; it moves into the history window
+    void pop() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    // Copying variant for callers that want a value
+    bool pop(T& out) {
+        const T* p = front();
+        if (!p) return false;
+        out = *p;
+        pop();
+        return true;
+    }
+
+    // Already-consumed record i steps back (0 = most recently popped), or
+    // nullptr if it is outside the retained history
+    const T* history(uint32_t i) const {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (i >= HISTORY || i >= tail) return nullptr;
+        return &buf_[(tail - 1 - i) & kMask];
+    }
+
+    // Unread records
+    uint32_t size() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_relaxed);
+    }
+
+    // Records rejected because the ring was full
+    uint32_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    static constexpr uint32_t capacity() { return N - HISTORY; }
+
+   private:
+    static constexpr uint32_t kMask = N - 1;
+    T buf_[N];
+    std::atomic<uint32_t> head_{0};  // written by producer only
+    std::atomic<uint32_t> tail_{0};  // written by consumer only
+    std::atomic<uint32_t> dropped_{0};
+};
+
+// Lock-free bounded multi-producer/single-consumer queue of fixed-size
+// records (per-slot sequence numbers, after D. Vyukov).
+//
+// Producers claim a slot with one CAS, fill it in place and publish it; they
+// never wait, a full queue drops the record and counts it. A producer that
+// is preempted between claim and publish only holds up the consumer at that
+// slot, not the other producers.
+template <typename T, uint32_t N>
+class MpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0,
+                  "capacity must be a power of two");
+
+   public:
+    MpscQueue() {
+        for (uint32_t i = 0; i < N; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // ---- producer side (any task) ----
+    // Slot for the next record, or nullptr (drop counted) if full; hand it
+    // back with publish(ticket)
+    T* claim(uint32_t& ticket) {
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & kMask];
+            uint32_t seq = c.seq.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    ticket = pos;
+                    return &c.v;
+                }
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    void publish(uint32_t ticket) {
+        cells_[ticket & kMask].seq.store(ticket + 1,
+                                         std::memory_order_release);
+    }
+
+    // ---- consumer side ----
+    // Oldest published record, or nullptr. Valid until pop().
+    const T* front() const {
+        const Cell& c = cells_[tail_ & kMask];
+        uint32_t seq = c.seq.load(std::memory_order_acquire);
+        return seq == tail_ + 1 ? &c.v : nullptr;
+    }
+    void pop() {
+        cells_[tail_ & kMask].seq.store(tail_ + N, std::memory_order_release);
+        tail_++;
+    }
+
+    // Records rejected because the queue was full
+    uint32_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        T v;
+    };
+    static constexpr uint32_t kMask = N - 1;
+    Cell cells_[N];
+    std::atomic<uint32_t> head_{0};
+    uint32_t tail_ = 0;  // consumer only
+    std::atomic<uint32_t> dropped_{0};
+};
+
+// Lock-free single-writer/single-reader slot holding the latest value
+// (triple buffer). The writer fills its own back buffer and trades it for
+// the shared middle one in one atomic exchange; the reader trades the
+// middle one for its front buffer when it holds something new. Neither
+// side waits or sees a half-written value. Values the reader did not get
+// to are replaced, not queued.
+template <typename T>
+class LatestValue {
+   public:
+    // ---- writer side ----
+    void publish(const T& v) {
+        buf_[back_] = v;
+        back_ = mid_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+                kIndex;
+    }
+
+    // ---- reader side ----
+    // Newest value, or nullptr if nothing was published since the last
+    // call. Valid until the next take().
+    const T* take() {
+        if (!(mid_.load(std::memory_order_relaxed) & kFresh)) return nullptr;
+        front_ = mid_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+        return &buf_[front_];
+    }
+
+   private:
+    static constexpr uint8_t kIndex = 3;
+    static constexpr uint8_t kFresh = 4;
+    T buf_[3] = {};
+    uint8_t back_ = 0;  // writer only
+    std::atomic<uint8_t> mid_{1};
+    uint8_t front_ = 2;  // reader only
+};
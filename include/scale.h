@@ -1,17 +1,54 @@
 #pragma once
 #include <Arduino.h>
-#include <HX711.h>
+
+#include <atomic>
 
 #include "config.h"
+#include "estimator.h"
+#include "hx711_driver.h"
+#include "ring.h"
+#include "stability.h"
+#include "timebase.h"
+
+class FastCutoff;
 
 class Scale {
    public:
-    // Initialize with data pin, clock pin, and HX711
+    // One processed sample, handed from the sampling task to the controller
+    // as a unit so x/v/a always belong together.
+    struct Sample {
+        uint32_t seq = 0;          // increments with every processed sample
+        uint64_t t_us = 0;         // DRDY time (monoUs)
+        int32_t raw = 0;           // raw counts after tare
+        int32_t x_mg = 0;          // fast estimate
+        float v_mgps = 0.0f;       // mg per second
+        float a_mgps2 = 0.0f;      // mg per s^2
+        int32_t filt_mg = 0;       // slow/display output
+        bool stable = false;
+    };
+
+    // Initialize HX711 on data/clock pins; starts the sampling task
     void begin(uint8_t dtPin, uint8_t sckPin);
 
-    // Call often; consumes samples when DRDY fires
+    // Call often; tracks sensor health. Only consumes samples itself when the
+    // sampling task could not be started.
     void update();
 
+    // Latest processed sample (consistent copy)
+    Sample latest() const;
+
+    // Every processed sample, in order; consumed by the controller only.
+    // Gaps in Sample::seq mean the ring was full and samples were dropped.
+    using SampleRing = SpscRing<Sample, SAMPLE_RING_SIZE, SAMPLE_RING_HISTORY>;
+    SampleRing& samples() { return ring_; }
+
+    // Task to notify after each published sample (e.g. the loop() task)
+    void notifyOnSample(TaskHandle_t task) { consumer_ = task; }
+
+    // Cutoff checked on every sample right after the estimator, before it
+    // is queued (sampling context); nullptr disables it
+    void setFastCutoff(FastCutoff* c) { cutoff_ = c; }
+
     // Minimum spacing between processed samples (ms) to allow decimation
     void setSamplePeriodMs(uint16_t ms);
 
@@ -19,24 +56,47 @@ class Scale {
     void tare();
 
     // Slow/display output (smoothed)
-    int32_t filteredMg() const { return filt_mg_; }
+    int32_t filteredMg() const { return pub_.filt_mg; }
 
-    // Fast estimator outputs (for control)
-    int32_t fastMg() const { return (int32_t)x_hat_mg_; }
-    float flowGps() const { return v_hat_mgps_ / 1000.0f; }  // grams per second
-    float vHatMgps() const { return v_hat_mgps_; }           // mg per second
-    float aHatMgps2() const { return a_hat_mgps2_; }         // mg per s^2
+    // Fast estimator outputs (for control); prefer latest() for a
+    // consistent x/v/a triple
+    int32_t fastMg() const { return pub_.x_mg; }
+    float flowGps() const { return pub_.v_mgps / 1000.0f; }  // grams per second
+    float vHatMgps() const { return pub_.v_mgps; }           // mg per second
+    float aHatMgps2() const { return pub_.a_mgps2; }         // mg per s^2
 
     // Raw
-    int32_t rawCounts() const { return weight_raw_; }        // raw minus tare
-    int32_t rawNoTare() const { return last_raw_no_tare_; }  // raw without tare
+    int32_t rawCounts() const {  // raw minus tare
+        return weight_raw_.load(std::memory_order_relaxed);
+    }
+    int32_t rawNoTare() const {  // raw without tare
+        return last_raw_no_tare_.load(std::memory_order_relaxed);
+    }
 
     // Tare persistence helpers
-    int32_t tareRaw() const { return tare_raw_; }
-    void setTareRaw(int32_t v) { tare_raw_ = v; }
+    int32_t tareRaw() const {
+        return tare_raw_.load(std::memory_order_relaxed);
+    }
+    void setTareRaw(int32_t v) {
+        tare_raw_.store(v, std::memory_order_relaxed);
+    }
 
     // Stability
-    bool isStable() const { return stable_; }
+    bool isStable() const { return pub_.stable; }
+
+#if SCALE_ESTIMATOR_KALMAN
+    using FastEstimator = KalmanCaEstimator;
+    // Kalman noise for measuring (fast period) and idle sampling (tuning/replay)
+    void setKalmanNoise(const KalmanCaEstimator::Noise& fast,
+                        const KalmanCaEstimator::Noise& idle) {
+        kf_fast_ = fast;
+        kf_idle_ = idle;
+    }
+#else
+    using FastEstimator = AlphaBetaEstimator;
+    // Fast α–β estimator gains (tuning/replay)
+    void setAlphaBeta(float g, float h) { est_.setGains(g, h); }
+#endif
 
     // Calibration factor at runtime (Q16 mg per count)
     void setCalMgPerCountQ16(int32_t q16) { cal_q16_ = q16; }
@@ -46,18 +106,45 @@ class Scale {
     static void IRAM_ATTR drdyISR();
     static Scale* instance_;
 
+    // Sampling task body
+    void taskLoop();
+    static void taskThunk(void* self);
+    // Process one conversion read at DRDY time now_us
+    void acquire(int32_t raw, uint64_t now_us);
+    // Estimator + stability on one raw reading, then publish
+    void processSample(int32_t raw, uint64_t now_us);
+    void updateStability(uint64_t now_us);
+    void publish(uint64_t now_us);
+    bool decimating(uint64_t t_us) const {
+        return last_sample_us_ != 0 &&
+               (t_us - last_sample_us_) < msToUs(period_ms_);
+    }
+
     volatile bool drdy_pending_ = false;
+    volatile uint64_t drdy_us_ = 0;  // stamped in the ISR on the DRDY edge
+    uint64_t read_t_us_ = 0;         // DRDY time of the read in flight
     uint8_t dt_pin_ = 0;
+    TaskHandle_t task_ = nullptr;
+    TaskHandle_t consumer_ = nullptr;
+    FastCutoff* cutoff_ = nullptr;
+
+    // handoff to the controller
+    mutable portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+    Sample pub_;
+    SampleRing ring_;
+    uint32_t seq_ = 0;
 
-    HX711 hx_;
+    Hx711 hx_;
     bool ok_ = false;
-    int32_t tare_raw_ = 0;
-    int32_t weight_raw_ = 0;        // after tare
-    int32_t last_raw_no_tare_ = 0;  // before tare
+    // written by the sampling task, read by loop() (tare is the reverse)
+    std::atomic<int32_t> tare_raw_{0};
+    std::atomic<int32_t> weight_raw_{0};        // after tare
+    std::atomic<int32_t> last_raw_no_tare_{0};  // before tare
 
     // timing
     uint16_t period_ms_ = 100;
-    uint32_t last_sample_ms_ = 0;
+    // 64 bits take two stores on the ESP32: update() reads it under mux_
+    uint64_t last_sample_us_ = 0;
 
     // slow/display filter
     int32_t buf_[3] = {0, 0, 0};
@@ -68,17 +155,15 @@ class Scale {
     // calibration
     int32_t cal_q16_ = 1 << 16;  // mg per count in Q16
 
-    // fast α–β estimator (position & velocity); plus EMA accel estimate
-    float x_hat_mg_ = 0.0f;     // mg
-    float v_hat_mgps_ = 0.0f;   // mg/s
-    float a_hat_mgps2_ = 0.0f;  // mg/s^2 (EMA of dv/dt)
-    const float g_ = 0.4f;      // α gain (0..1)
-    const float h_ = 0.08f;     // β gain (~0..1)
-    float last_v_hat_ = 0.0f;
+    // fast estimator (x, v, a) feeding the cutoff
+    FastEstimator est_;
+#if SCALE_ESTIMATOR_KALMAN
+    KalmanCaEstimator::Noise kf_fast_ = {KF_Q_JERK_FAST, KF_R_FAST_MG2};
+    KalmanCaEstimator::Noise kf_idle_ = {KF_Q_JERK_IDLE, KF_R_IDLE_MG2};
+#endif
 
     // Stability window
-    int32_t win_[STAB_WINDOW_SAMPLES] = {0};
-    uint8_t wcount_ = 0, widx_ = 0;
+    StabilityDetector stab_;
     bool stable_ = false;
-    uint32_t stable_since_ = 0;
+    uint64_t stable_since_us_ = 0;
 };
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+
+#include "config.h"
+
+// Sliding-window quietness test over the last window_ms of readings.
+//
+// Everything is incremental: a running sum and sum of squares give the
+// variance, two monotonic deques give min and max, so each push is O(1)
+// amortised regardless of window length or sample rate. The variance test
+// compares integer moments against the squared limit (no division, no sqrt).
+class StabilityDetector {
+   public:
+    static constexpr uint32_t kCap = STAB_WINDOW_MAX_SAMPLES;
+    static_assert((kCap & (kCap - 1)) == 0, "capacity must be a power of two");
+
+    explicit StabilityDetector(uint32_t window_ms = STAB_WINDOW_MS)
+        : win_us_(window_ms * 1000u) {}
+
+    void setWindowMs(uint32_t ms);
+    void reset();
+
+    // Add a reading; drops those older than the window (or beyond kCap)
+    void push(uint64_t t_us, int32_t mg);
+
+    // Fed for at least one whole window
+    bool full() const { return primed_ && span_ok_; }
+    uint32_t count() const { return head_ - tail_; }
+
+    int32_t peakToPeak() const;
+    // Same as (int)sqrt(population variance) <= stddev_mg
+    bool stddevWithin(int32_t stddev_mg) const;
+
+   private:
+    struct Entry {
+        uint32_t t_us;  // low 32 bits of the timestamp (windows << 71 min)
+        int32_t mg;
+    };
+    void popOldest();
+
+    static constexpr uint32_t kMask = kCap - 1;
+    uint32_t win_us_;
+    Entry buf_[kCap];
+    uint32_t head_ = 0, tail_ = 0;  // sequence numbers, index = seq & kMask
+    // monotonic deques of sequence numbers: values increasing / decreasing
+    uint32_t minq_[kCap], maxq_[kCap];
+    uint32_t min_h_ = 0, min_t_ = 0, max_h_ = 0, max_t_ = 0;
+    int64_t sum_ = 0, sumsq_ = 0;
+    uint32_t first_us_ = 0;  // first reading since reset
+    bool primed_ = false, span_ok_ = false;
+};
@@ -5,7 +5,10 @@ enum class AppState : uint8_t {
     SHOW_SETPOINT,
     MEASURING,
     DONE_HOLD,
+    TOPUP_SETTLE,  // under-dosed: wait for a stable reading, then pulse
+    TOPUP_PULSE,   // relay on for one top-up pulse
     CAL_ZERO,  // long-press enters calibration: capture zero
     CAL_SPAN,  // prompt to place known mass; long-press to capture span
+    PROFILE_SELECT,  // long-press start: encoder picks a dosing profile
     ERROR_STATE
 };
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+#include <atomic>
+
+// One relay-off per run for the paths outside loop(). The fast path
+// (sampling task) and the cutoff timer (esp_timer task) both claim it before
+// switching the relay off; the first claim wins and the other path stands
+// down, so there is one off command and one recorded stop per run. The
+// controller resets it once it has taken over the stop.
+class StopLatch {
+   public:
+    enum Path : uint8_t { NONE = 0, FAST, TIMER };
+
+    // True for the first claim since reset()
+    bool claim(Path p) {
+        uint8_t none = NONE;
+        return who_.compare_exchange_strong(none, p,
+                                            std::memory_order_acq_rel);
+    }
+    bool claimed() const {
+        return who_.load(std::memory_order_acquire) != NONE;
+    }
+    void reset() { who_.store(NONE, std::memory_order_release); }
+
+   private:
+    std::atomic<uint8_t> who_{NONE};
+};
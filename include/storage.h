@@ -1,14 +1,24 @@
 #pragma once
 #include <Arduino.h>
 
+#include "latency.h"
+#include "profiles.h"
+#include "relay.h"
+
 namespace storage {
 void begin();
 int32_t loadCalQ16(int32_t def);
 void saveCalQ16(int32_t v);
 int32_t loadTareRaw(int32_t def);
 void saveTareRaw(int32_t v);
-int32_t loadSetpointMg(int32_t def);
-void saveSetpointMg(int32_t v);
-float loadKv(float def);
-void saveKv(float v);
+// Profile blob; without one, the config defaults are used and the first
+// profile takes over the legacy setpoint and overshoot table / k_v.
+// Older blob layouts and the legacy keys are migrated here, once: the
+// result is saved right away and the legacy keys are removed.
+// Returns false if nothing usable was stored.
+bool loadProfiles(ProfileStore& p);
+void saveProfiles(const ProfileStore& p);
+// Learned switch-off latency of one actuator; the default without one
+void loadLatency(Actuator a, LatencyEstimate& tau);
+void saveLatency(Actuator a, const LatencyEstimate& tau);
 }  // namespace storage
@@ -18,7 +18,9 @@ class SwitchWorker {
     // Enqueue ON/OFF by AIN
     bool on(const char* ain);
     bool off(const char* ain);
-    bool toggle(const char* ain, bool state);
+    // wait: ticks to wait for room in the queue
+    bool toggle(const char* ain, bool state,
+                TickType_t wait = pdMS_TO_TICKS(10));
 
     // Optional: stop task and free queue
     void end();
@@ -34,7 +36,7 @@ class SwitchWorker {
         char ain[24];
     };
 
-    bool enqueue(Cmd c, const char* ain);
+    bool enqueue(Cmd c, const char* ain, TickType_t wait = pdMS_TO_TICKS(10));
 
     // Task body
     void taskLoop();
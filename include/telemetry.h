@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+
+#include "config.h"
+
+// Per-sample telemetry of the last TELEMETRY_RUNS runs, for diagnosing bad
+// doses without printf in the hot path.
+//
+// Every sample consumed while measuring becomes one 16-byte fixed-point
+// record in a preallocated ring shared by all runs; a run whose first record
+// has been overwritten is dropped as a whole. Recording is a handful of
+// stores from loop(), after the cutoff has decided. The serial "b" command
+// dumps the kept runs as CRC-framed binary; "program decode" on the host
+// turns a dump into CSV.
+class TelemetryLog {
+   public:
+    // Record flags
+    enum : uint8_t {
+        RELAY = 1 << 0,     // relay on after this sample
+        APPROACH = 1 << 1,  // duty-cycling near the target
+        STOP = 1 << 2,      // the run stopped on this sample
+        FAST = 1 << 3,      // ...switched off by the sampling task
+        TIMER = 1 << 4,     // cutoff timer armed after this sample
+        LSQ = 1 << 5,       // least-squares engine decided
+    };
+
+    // One sample; little-endian, 24-bit fields as bytes so the layout is
+    // the same on the host decoder
+    struct Record {
+        uint16_t dt_us;     // since the previous record (saturates)
+        uint8_t flags;
+        uint8_t lost;       // samples dropped before this one (saturates)
+        uint8_t counts[3];  // raw counts after tare
+        uint8_t x_mg[3];    // fast estimate
+        int16_t v_mgps;     // 1 mg/s
+        int16_t a_q;        // kAccelUnit mg/s^2
+        int16_t lead_mg;    // setpoint - cutoff threshold
+    };
+    static_assert(sizeof(Record) == 16, "telemetry record must stay packed");
+    static constexpr float kAccelUnit = 8.0f;  // +-262 g/s^2 in an int16
+
+    // Run end reasons
+    enum End : uint8_t { OPEN = 0, AUTO, MANUAL, TIMEOUT };
+
+    struct Run {
+        uint32_t first = 0;  // absolute index of the first record
+        uint16_t n = 0;
+        uint16_t number = 0;  // runs since boot, 0 = empty slot
+        uint64_t t0_us = 0;   // DRDY time of the first record
+        int32_t setpoint_mg = 0;
+        int32_t cal_q16 = 0;
+        int32_t tare_raw = 0;
+        float tau_ms = 0.0f;
+        int32_t final_mg = 0;  // settled dose, valid once ended
+        uint64_t cutoff_us = 0;  // relay off, 0 if never switched off
+        uint8_t profile = 0;
+        uint8_t end = OPEN;
+        bool overflow = false;  // longer than the ring, tail missing
+    };
+
+    // Frame: sync, type, payload length (u16), payload, CRC-16/CCITT over
+    // type, length and payload
+    static constexpr uint8_t kSync0 = 0xA5, kSync1 = 0x5A;
+    static constexpr uint8_t kVersion = 1;
+    enum FrameType : uint8_t { FRAME_RUN = 'R', FRAME_END = 'E' };
+    // version, number, profile, end, overflow, t0_us, setpoint, cal, tare,
+    // tau (0.1 ms), final, cutoff (us after t0), record count
+    static constexpr size_t kRunHeaderSize = 1 + 2 + 1 + 1 + 1 + 8 + 4 + 4 +
+                                             4 + 2 + 4 + 4 + 2;
+
+    // Starts a run with info's parameters; an open one is closed first
+    void beginRun(const Run& info);
+    void sample(uint64_t t_us, uint8_t lost, int32_t counts, int32_t x_mg,
+                float v_mgps, float a_mgps2, float lead_mg, uint8_t flags);
+    void endRun(End why, int32_t final_mg, uint64_t cutoff_us);
+    bool recording() const { return open_; }
+
+    // Kept runs, oldest first, then an end frame
+    void dump(HardwareSerial& out) const;
+
+    static uint16_t crc16(uint16_t crc, const uint8_t* p, size_t n);
+    static_assert(kRunHeaderSize + TELEMETRY_RECORDS * sizeof(Record) <=
+                      UINT16_MAX,
+                  "a run must fit one frame");
+
+   private:
+    bool kept(const Run& r) const { return w_ - r.first <= kCap; }
+
+    static constexpr uint32_t kCap = TELEMETRY_RECORDS;
+    Record rec_[TELEMETRY_RECORDS];
+    uint32_t w_ = 0;   // absolute write index
+    uint16_t wi_ = 0;  // w_ % kCap, without the division
+    Run runs_[TELEMETRY_RUNS];
+    uint8_t next_run_ = 0;  // slot of the next run
+    uint16_t number_ = 0;
+    uint64_t last_us_ = 0;
+    bool open_ = false;
+};
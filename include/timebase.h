@@ -0,0 +1,10 @@
+#pragma once
+#include <esp_timer.h>
+#include <stdint.h>
+
+// Shared monotonic timebase in microseconds since boot. 64 bits do not wrap
+// in the lifetime of a unit, so deadlines can be compared directly
+// (now > until) and dt never needs wrap handling. Safe to call from ISRs.
+inline uint64_t monoUs() { return (uint64_t)esp_timer_get_time(); }
+
+inline constexpr uint64_t msToUs(uint32_t ms) { return (uint64_t)ms * 1000u; }
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+
+#include "config.h"
+
+// Mass a relay pulse of a given length adds to the cup.
+//
+// A pulse of T ms delivers roughly k * (T - TOPUP_DEAD_MS): the motor spins
+// up for the whole pulse and coasts down after it, and the two roughly
+// cancel past a short dead time. k (mg per pulse ms) is learned per profile
+// from the settled mass each pulse added; until the first pulse has been
+// measured the run's averaged flow stands in for it.
+struct PulseModel {
+    float mg_per_ms = 0.0f;  // learned k, 0 = no pulse measured yet
+    uint8_t pulses = 0;      // measurements folded in (saturates)
+
+    void reset() { *this = PulseModel(); }
+    // Pulse length (ms) for deficit_mg, clamped to TOPUP_MIN_MS..TOPUP_MAX_MS;
+    // 0 when neither a learned k nor a usable flow (mg/s) is known
+    uint32_t lengthMs(int32_t deficit_mg, float flow_mgps) const;
+    void learn(uint32_t len_ms, int32_t delivered_mg);
+};
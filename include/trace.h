@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+
+#include "config.h"
+#include "overshoot_table.h"
+
+// Records one grinding run for offline replay: raw HX711 counts at their
+// DRDY timestamps and relay edges, plus the parameters the controller used.
+// Dumped as text over serial ("t" command) and read back by the host replay
+// engine (src/native/replay.cpp).
+class TraceRecorder {
+   public:
+    struct Header {
+        int32_t cal_q16 = 0;
+        int32_t tare_raw = 0;
+        int32_t setpoint_mg = 0;
+        float tau_comm_ms = TAU_COMM_MS;  // learned actuator latency
+        uint8_t ot[OvershootTable::kBlobSize] = {};  // learned table blob
+    };
+
+    enum Kind : uint8_t { SAMPLE = 0, RELAY = 1 };
+    struct Event {
+        uint32_t dt_us;  // since trace start
+        int32_t value;   // counts (SAMPLE) or 0/1 (RELAY)
+        uint8_t kind;
+    };
+
+    // Starts a new trace, discarding the previous one
+    void begin(const Header& h, uint64_t t0_us);
+    void sample(uint64_t t_us, int32_t counts) { add(t_us, counts, SAMPLE); }
+    void relay(uint64_t t_us, bool on) { add(t_us, on ? 1 : 0, RELAY); }
+    void end() { recording_ = false; }
+
+    bool recording() const { return recording_; }
+    uint16_t size() const { return n_; }
+    bool overflowed() const { return overflow_; }
+
+    // "#trace" header, one "S,t_us,counts" / "R,t_us,on" line per event, "#end"
+    void dump(HardwareSerial& out) const;
+
+   private:
+    void add(uint64_t t_us, int32_t value, uint8_t kind);
+
+    Header h_;
+    uint64_t t0_us_ = 0;
+    Event ev_[TRACE_MAX_EVENTS];
+    uint16_t n_ = 0;
+    bool recording_ = false;
+    bool overflow_ = false;
+};
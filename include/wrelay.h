@@ -11,7 +11,9 @@ class WifiRelay : public Relay {
           : ain_(ain), _worker(client) {}
 
      void begin(uint8_t pin);
-     void set(bool on);
+     void set(bool on) override;
+     bool trySet(bool on) override;
+     Actuator actuator() const override { return Actuator::PLUG; }
 
     private:
      const char* ain_;
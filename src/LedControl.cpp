@@ -43,18 +43,27 @@
 #define OP_SHUTDOWN    12
 #define OP_DISPLAYTEST 15
 
-LedControl::LedControl(int dataPin, int clkPin, int csPin, int numDevices) {
+LedControl::LedControl(int dataPin, int clkPin, int csPin, int numDevices,
+                       int spiHost) {
+    begin(dataPin,clkPin,csPin,numDevices,spiHost);
+}
+
+void LedControl::begin(int dataPin, int clkPin, int csPin, int numDevices,
+                       int spiHost) {
+    spi.end();
     SPI_MOSI=dataPin;
     SPI_CLK=clkPin;
     SPI_CS=csPin;
     if(numDevices<=0 || numDevices>8 )
         numDevices=8;
     maxDevices=numDevices;
-    pinMode(SPI_MOSI,OUTPUT);
-    pinMode(SPI_CLK,OUTPUT);
-    pinMode(SPI_CS,OUTPUT);
-    digitalWrite(SPI_CS,HIGH);
-    SPI_MOSI=dataPin;
+    useSpi=spiHost>=0 && spi.begin(spiHost,dataPin,clkPin,csPin,maxDevices*2);
+    if(!useSpi) {
+        pinMode(SPI_MOSI,OUTPUT);
+        pinMode(SPI_CLK,OUTPUT);
+        pinMode(SPI_CS,OUTPUT);
+        digitalWrite(SPI_CS,HIGH);
+    }
     for(int i=0;i<64;i++) 
         status[i]=0x00;
     for(int i=0;i<maxDevices;i++) {
@@ -170,13 +179,29 @@ void LedControl::setDigit(int addr, int digit, byte value, boolean dp) {
 
 void LedControl::setChar(int addr, int digit, char value, boolean dp) {
     int offset;
-    byte index,v;
+    byte v;
 
     if(addr<0 || addr>=maxDevices)
         return;
     if(digit<0 || digit>7)
         return;
     offset=addr*8;
+    v=charSegments(value,dp);
+    status[offset+digit]=v;
+    spiTransfer(addr, digit+1,v);
+}
+
+byte LedControl::getRow(int addr, int row) {
+    if(addr<0 || addr>=maxDevices)
+        return 0;
+    if(row<0 || row>7)
+        return 0;
+    return status[addr*8+row];
+}
+
+byte LedControl::charSegments(char value, boolean dp) {
+    byte index,v;
+
     index=(byte)value;
     if(index >127) {
         //no defined beyond index 127, so we use the space char
@@ -185,8 +210,7 @@ void LedControl::setChar(int addr, int digit, char value, boolean dp) {
     v=pgm_read_byte_near(charTable + index); 
     if(dp)
         v|=0b10000000;
-    status[offset+digit]=v;
-    spiTransfer(addr, digit+1,v);
+    return v;
 }
 
 void LedControl::spiTransfer(int addr, byte opcode, byte data) {
@@ -199,6 +223,32 @@ void LedControl::spiTransfer(int addr, byte opcode, byte data) {
     //put our device data into the array
     spidata[offset+1]=opcode;
     spidata[offset]=data;
+    sendChain();
+}
+
+void LedControl::setRowAll(int row, const byte* values) {
+    if(row<0 || row>7)
+        return;
+    //every device gets its own data for the same register
+    for(int addr=0;addr<maxDevices;addr++) {
+        status[addr*8+row]=values[addr];
+        spidata[addr*2+1]=row+1;
+        spidata[addr*2]=values[addr];
+    }
+    sendChain();
+}
+
+void LedControl::sendChain() {
+    int maxbytes=maxDevices*2;
+
+    if(useSpi) {
+        //queue the bytes in the order they go out, CS is toggled by the host
+        byte wire[16];
+        for(int i=0;i<maxbytes;i++)
+            wire[i]=spidata[maxbytes-1-i];
+        spi.write(wire);
+        return;
+    }
     //enable the line 
     digitalWrite(SPI_CS,LOW);
     //Now shift out the data 
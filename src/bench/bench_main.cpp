@@ -0,0 +1,125 @@
+// On-target benchmarks (pio run -e bench -t upload && pio device monitor).
+// Not part of the firmware; the default env excludes src/bench/.
+#include <Arduino.h>
+#include <HX711.h>
+
+#include "config.h"
+#include "est_bench.h"
+#include "hx711_driver.h"
+#include "timebase.h"
+
+namespace {
+
+struct Stat {
+    uint32_t n = 0;
+    uint64_t sum = 0;
+    uint32_t mn = UINT32_MAX, mx = 0;
+    void add(uint32_t us) {
+        n++;
+        sum += us;
+        if (us < mn) mn = us;
+        if (us > mx) mx = us;
+    }
+    void print(const char* name) const {
+        Serial.printf("%-28s n=%lu min=%lu mean=%.1f max=%lu us\n", name,
+                      (unsigned long)n, (unsigned long)mn,
+                      n ? (double)sum / n : 0.0, (unsigned long)mx);
+    }
+};
+
+constexpr int kSamples = 200;
+
+// ---- HX711: main-loop stall per sample, library vs. SPI driver ----
+void benchHx711() {
+    Serial.println("HX711 readout: CPU time the caller is blocked per sample");
+
+    // bogde/HX711: read() bit-bangs 25 pulses with busy-waits
+    {
+        HX711 lib;
+        lib.begin(PIN_HX_DT, PIN_HX_SCK);
+        Stat st;
+        for (int i = 0; i < kSamples; ++i) {
+            while (!lib.is_ready()) delay(1);
+            uint64_t t0 = monoUs();
+            lib.read();
+            st.add((uint32_t)(monoUs() - t0));
+        }
+        st.print("bogde/HX711 read()");
+    }
+
+    // Local driver: start + non-blocking polls; only time inside calls counts
+    {
+        Hx711 hx;
+        if (!hx.begin(PIN_HX_DT, PIN_HX_SCK,
+                      (Hx711::Gain)HX711_GAIN_PULSES)) {
+            Serial.println("Hx711 SPI init failed");
+            return;
+        }
+        Stat start, poll, total;
+        for (int i = 0; i < kSamples; ++i) {
+            while (!hx.isReady()) delay(1);
+            uint64_t t0 = monoUs();
+            hx.startRead();
+            uint32_t busy = (uint32_t)(monoUs() - t0);
+            start.add(busy);
+            int32_t raw;
+            for (;;) {
+                uint64_t t1 = monoUs();
+                bool done = hx.completeRead(raw);
+                uint32_t d = (uint32_t)(monoUs() - t1);
+                poll.add(d);
+                busy += d;
+                if (done) break;
+                delayMicroseconds(5);  // stands in for other loop() work
+            }
+            total.add(busy);
+        }
+        start.print("Hx711 startRead()");
+        poll.print("Hx711 completeRead(0) poll");
+        total.print("Hx711 total per sample");
+    }
+}
+
+// ---- Estimator update: CPU cycles per sample ----
+void benchEstimators() {
+    Serial.println("Estimator update (cycles/sample, 80 SPS input)");
+    estbench::Input in;
+    auto ccount = []() { return (uint32_t)ESP.getCycleCount(); };
+
+    estbench::AlphaBetaDiv ab_div;
+    AlphaBetaEstimator ab;
+    KalmanCaFull kf_full;
+    KalmanCaEstimator kf;
+    kf_full.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+    kf.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+
+    Serial.printf("%-34s %lu\n", "alpha-beta, per-sample divisions",
+                  (unsigned long)estbench::cyclesPerUpdate(ab_div, in, ccount));
+    Serial.printf("%-34s %lu\n", "alpha-beta, gain table",
+                  (unsigned long)estbench::cyclesPerUpdate(ab, in, ccount));
+    Serial.printf("%-34s %lu\n", "Kalman CA, full covariance",
+                  (unsigned long)estbench::cyclesPerUpdate(kf_full, in, ccount));
+    Serial.printf("%-34s %lu\n", "Kalman CA, steady-state gain table",
+                  (unsigned long)estbench::cyclesPerUpdate(kf, in, ccount));
+
+    // what a table miss (new rate) costs once
+    uint32_t t0 = ccount();
+    float K[3];
+    KalmanCaFull::steadyGain({KF_Q_JERK_FAST, KF_R_FAST_MG2}, 0.0125f, K);
+    Serial.printf("%-34s %lu\n", "Kalman gain solve (table miss)",
+                  (unsigned long)(ccount() - t0));
+}
+
+}  // namespace
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        ;
+    }
+    delay(500);
+    benchEstimators();
+    benchHx711();
+}
+
+void loop() { delay(1000); }
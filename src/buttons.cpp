@@ -1,6 +1,7 @@
 #include "buttons.h"
 
 #include "config.h"
+#include "timebase.h"
 
 Buttons::Buttons(uint32_t longPressMs) : long_press_ms_(longPressMs) {}
 
@@ -10,16 +11,17 @@ void Buttons::begin(uint8_t pinStart) {
 }
 
 void Buttons::update() {
+    uint64_t now = monoUs();
     bool v = digitalRead(ps_);
     if (v != last_) {
-        t_ = millis();
+        t_us_ = now;
         last_ = v;
     }
-    if ((millis() - t_) > DEBOUNCE_MS && v != stable_) {
+    if ((now - t_us_) > msToUs(DEBOUNCE_MS) && v != stable_) {
         stable_ = v;
         if (stable_ == LOW) {
             pressed_ = true;
-            pressed_since_ = millis();
+            pressed_since_us_ = now;
             edge_ = false;
             long_edge_ = false;
             long_latched_ = false;
@@ -33,7 +35,7 @@ void Buttons::update() {
 
     // long press detection
     if (pressed_ && !long_edge_ && !long_latched_ &&
-        (millis() - pressed_since_) >= long_press_ms_) {
+        (now - pressed_since_us_) >= msToUs(long_press_ms_)) {
         long_edge_ = true;
         long_latched_ = true;
         edge_ = false;  // suppress short press for this hold
@@ -1,7 +1,11 @@
 #include "controller.h"
 
+#include <string.h>
+
 #include "config.h"
+#include "profiler.h"
 #include "storage.h"
+#include "timebase.h"
 #include "utils.h"
 
 void Controller::begin(Scale* sc, Encoder* enc, Buttons* btn, Display* disp,
@@ -11,23 +15,306 @@ void Controller::begin(Scale* sc, Encoder* enc, Buttons* btn, Display* disp,
     btn_ = btn;
     disp_ = disp;
     rel_ = rel;
+    cutoff_timer_.begin(rel, &stop_latch_);
+    fast_cut_.begin(rel, &stop_latch_);
+    sc_->setFastCutoff(&fast_cut_);
+}
+
+bool Controller::cutoffReached(const Scale::Sample& s) const {
+    if (tuning_.engine == CutoffEngine::LSQ && flow_.ready())
+        return cutoffReachedLsq();
+
+    return remainingMg(s) <= 0;
+}
+
+int32_t Controller::remainingMg(const Scale::Sample& s) const {
+    const Profile& p = profiles_.active();
+    float v = s.v_mgps;   // mg/s
+    float a = s.a_mgps2;  // mg/s^2
+    float tau = TAU_MEAS_MS / 1000.0f;  // s
+    // dynamic offset (mg): the sample's lag from v/a, what arrives during the
+    // actuator latency from the averaged flow, then the learned rest
+    float offset_dyn = v * tau + 0.5f * a * tau * tau + latencyMassMg() +
+                       p.ot.lookup(stopFlowMgps(v) / 1000.0f, p.setpoint_mg);
+    int32_t effective = p.setpoint_mg - (int32_t)lroundf(offset_dyn);
+    return effective - s.x_mg - tuning_.hysteresis_mg;
+}
+
+float Controller::stopFlowMgps(float v_mgps) const {
+    // while duty cycling v swings with every pulse; the table is keyed by
+    // the averaged flow instead, which settles on the pulsed rate
+    return approach_ ? flow_avg_mgps_ : v_mgps;
+}
+
+bool Controller::cutoffReachedLsq() const {
+    // Fire once the fitted trajectory reaches the target within the
+    // measurement latency; the actuator latency mass, learned overshoot and
+    // hysteresis lower the target just like in the formula engine
+    FlowPredictor::Fit f = flow_.fit();
+    return FlowPredictor::reachesWithin(f, lsqTargetMg(f),
+                                        TAU_MEAS_MS / 1000.0f);
+}
+
+float Controller::lsqTargetMg(const FlowPredictor::Fit& f) const {
+    const Profile& p = profiles_.active();
+    return p.setpoint_mg - tuning_.hysteresis_mg - latencyMassMg() -
+           p.ot.lookup(stopFlowMgps(f.v) / 1000.0f, p.setpoint_mg);
+}
+
+float Controller::latencyMassMg() const {
+    // Grounds landing after the relay-off command follow the flow over the
+    // latency, not the burst of the last sample: use the averaged flow
+    return flow_avg_mgps_ * tau_.ms / 1000.0f;
+}
+
+void Controller::trackFlow(const Scale::Sample& s) {
+    uint32_t dt_us = flow_avg_t_us_ ? (uint32_t)(s.t_us - flow_avg_t_us_) : 0;
+    flow_avg_t_us_ = s.t_us;
+    sample_dt_us_ = dt_us;
+    float k = (float)dt_us / (float)(msToUs(TAU_FLOW_AVG_MS) + dt_us);
+    flow_avg_mgps_ += k * (s.v_mgps - flow_avg_mgps_);
+}
+
+void Controller::updateApproach() {
+    uint64_t period = msToUs(APPROACH_PERIOD_MS);
+    uint64_t phase = (monoUs() - approach_t0_us_) % period;
+    bool on = phase < (uint64_t)(APPROACH_DUTY * period);
+    if (on == approach_on_) return;
+    // stop imminent or already cut in the sampling task: stay off
+    if (on && (cutoff_timer_.armed() || cutoff_timer_.fired() ||
+               fast_cut_.fired()))
+        return;
+    approach_on_ = on;
+    rel_->set(on);
+    // the sampling task or the timer may have cut in between; they win
+    if (on && (fast_cut_.fired() || cutoff_timer_.fired())) rel_->set(false);
+    if (trace_) trace_->relay(monoUs(), on);
+}
+
+uint64_t Controller::relayOff(uint64_t sample_us) {
+    // The fast path or the cutoff timer may have switched the relay off
+    // already, at their own time. sample_us is the DRDY time of the sample
+    // that decided in loop(), 0 for manual stops and timeouts. The relay is
+    // switched off here in any case: an approach pulse may have switched it
+    // back on after the timer fired.
+    fast_cut_.disarm();
+    cutoff_timer_.cancel();
+    rel_->set(false);
+    // at most one of them fired: they share the stop latch
+    uint64_t off_us;
+    if (fast_cut_.fired()) {
+        off_us = fast_cut_.firedUs();
+        cut_lat_.record(CutoffLatencyLog::FAST, fast_cut_.firedLatencyUs());
+    } else if (cutoff_timer_.fired()) {
+        off_us = cutoff_timer_.firedUs();
+        cut_lat_.record(CutoffLatencyLog::TIMER,
+                        (uint32_t)(off_us - plan_at_us_));
+    } else {
+        off_us = monoUs();
+        if (sample_us)
+            cut_lat_.record(CutoffLatencyLog::LOOP,
+                            (uint32_t)(off_us - sample_us));
+    }
+    fast_cut_.clear();
+    cutoff_timer_.clear();
+    stop_latch_.reset();
+    if (trace_) trace_->relay(off_us, false);
+    return off_us;
+}
+
+void Controller::armFastCutoff(float lead_mg) {
+    // the least-squares engine decides on the fit, which lives here
+    if (!tuning_.fast_cutoff ||
+        (tuning_.engine == CutoffEngine::LSQ && flow_.ready())) {
+        fast_cut_.disarm();
+        return;
+    }
+    // everything in the formula but the sample's own lag
+    fast_cut_.arm(profiles_.active().setpoint_mg - lead_mg);
+}
+
+float Controller::leadMg(float v_mgps) const {
+    // how far below the setpoint the predicted mass stops the run
+    const Profile& p = profiles_.active();
+    return tuning_.hysteresis_mg + latencyMassMg() +
+           p.ot.lookup(stopFlowMgps(v_mgps) / 1000.0f, p.setpoint_mg);
+}
+
+void Controller::scheduleCutoff(const Scale::Sample& s) {
+    // Time from this conversion until the cutoff condition would hold, from
+    // the same trajectory the engine decides on
+    FlowPredictor::Fit f;
+    float dt;
+    if (tuning_.engine == CutoffEngine::LSQ && flow_.ready()) {
+        f = flow_.fit();
+        dt = FlowPredictor::timeTo(f, lsqTargetMg(f)) - TAU_MEAS_MS / 1000.0f;
+    } else {
+        f = {(float)s.x_mg, s.v_mgps, s.a_mgps2};
+        dt = FlowPredictor::timeTo(f, f.m + (float)remainingMg(s));
+    }
+    // only arm for a crossing before the next sample can decide itself
+    // (half a period of slack for its processing)
+    if (!(dt * 1e6f < 1.5f * sample_dt_us_)) {
+        cutoff_timer_.cancel();
+        return;
+    }
+    if (dt < 0.0f) dt = 0.0f;
+    plan_v_mgps_ = f.v + f.a * dt;
+    plan_at_us_ = s.t_us + (uint64_t)(dt * 1e6f);
+    cutoff_timer_.arm(plan_at_us_);
+}
+
+void Controller::stopTimed() {
+    // learn from the flow the timer was armed for
+    stopRun(stopFlowMgps(plan_v_mgps_) / 1000.0f, false, 0);
+}
+
+void Controller::stopRun(float v_stop_gps, bool timed_out,
+                         uint64_t sample_us) {
+    // capture v at stop for learning
+    last_v_stop_gps_ = v_stop_gps;
+    topup_flow_mgps_ = flow_avg_mgps_;
+    cutoff_us_ = relayOff(sample_us);
+    // time the flow decay after an automatic stop at the running flow; a
+    // duty-cycled approach has slowed it down already
+    if (!timed_out && !approach_)
+        onset_.begin(cutoff_us_, flow_avg_mgps_);
+    else
+        onset_.cancel();
+    approach_ = false;
+    state_ = AppState::DONE_HOLD;
+    done_from_cal_ = false;
+    timed_out_ = timed_out;
+
+    tMeasureDoneUntil_ = monoUs() + msToUs(DONE_HOLD_MS);
+}
+
+void Controller::updateTopUp() {
+    uint64_t now = monoUs();
+    if (state_ == AppState::TOPUP_PULSE) {
+        if (now < tTopUpMin_) return;
+        rel_->set(false);
+        // coast-down and fall before the added mass can be read
+        state_ = AppState::TOPUP_SETTLE;
+        tTopUpMin_ = now + msToUs(TOPUP_SETTLE_MS);
+        tTopUpUntil_ = now + msToUs(TOPUP_SETTLE_MAX_MS);
+        return;
+    }
+    if (state_ != AppState::TOPUP_SETTLE || now < tTopUpMin_) return;
+    if (!sc_->isStable()) {
+        if (now > tTopUpUntil_) endTopUp();  // cup disturbed, give up
+        return;
+    }
+
+    Profile& p = profiles_.active();
+    int32_t mass = sc_->filteredMg();
+    // Less than before the last pulse (or the run's end), or far more short
+    // than a run ever ends: the cup was lifted or knocked, not under-dosed.
+    // Neither learn from it nor pulse onto an empty platform.
+    int32_t deficit = p.setpoint_mg - mass;
+    if (mass < topup_from_mg_ - tuning_.topup_tol_mg ||
+        deficit > TOPUP_MAX_DEFICIT_X * tuning_.topup_tol_mg) {
+        endTopUp();
+        return;
+    }
+    if (topup_n_ > 0) {
+        p.pulse.learn(topup_len_ms_, mass - topup_from_mg_);
+        topup_learned_ = true;
+    }
+    uint32_t len = p.pulse.lengthMs(deficit, topup_flow_mgps_);
+    if (deficit <= tuning_.topup_tol_mg ||
+        topup_n_ >= tuning_.topup_pulses || len == 0) {
+        endTopUp();
+        return;
+    }
+    topup_n_++;
+    topup_len_ms_ = len;
+    topup_from_mg_ = mass;
+    rel_->set(true);
+    // a WiFi plug blocks in set(); time the pulse from when it returns
+    state_ = AppState::TOPUP_PULSE;
+    tTopUpMin_ = monoUs() + msToUs(len);
+}
+
+void Controller::endTopUp() {
+    if (state_ == AppState::TOPUP_PULSE) rel_->set(false);
+    if (topup_learned_) storage::saveProfiles(profiles_);
+    topup_learned_ = false;
+    sc_->setSamplePeriodMs(HX711_PERIOD_IDLE_MS);
+    state_ = AppState::IDLE;
+}
+
+int32_t Controller::sampleMg(const Scale::Sample& s) const {
+    // unfiltered reading; the fit does its own smoothing
+    return (int32_t)(((int64_t)s.raw * sc_->calMgPerCountQ16()) >> 16) +
+           SCALE_OFFSET_MG;
+}
+
+int32_t Controller::hxCounts(const Scale::Sample& s) const {
+    // undo tare and compile-time offset: counts as read from the HX711
+    return s.raw + sc_->tareRaw() + SCALE_OFFSET_COUNTS;
+}
+
+void Controller::startTrace() {
+    TraceRecorder::Header h;
+    h.cal_q16 = sc_->calMgPerCountQ16();
+    h.tare_raw = sc_->tareRaw();
+    const Profile& p = profiles_.active();
+    h.setpoint_mg = p.setpoint_mg;
+    h.tau_comm_ms = tau_.ms;
+    p.ot.serialize(h.ot);
+
+    // pre-roll from the ring history so a replay starts with a settled filter
+    Scale::SampleRing& ring = sc_->samples();
+    uint32_t n = 0;
+    while (ring.history(n)) n++;
+    const Scale::Sample* first = n ? ring.history(n - 1) : nullptr;
+    trace_->begin(h, first ? first->t_us : monoUs());
+    for (uint32_t i = n; i-- > 0;) {
+        const Scale::Sample* s = ring.history(i);
+        trace_->sample(s->t_us, hxCounts(*s));
+    }
+}
+
+void Controller::startTelemetry() {
+    TelemetryLog::Run r;
+    const Profile& p = profiles_.active();
+    r.setpoint_mg = p.setpoint_mg;
+    r.cal_q16 = sc_->calMgPerCountQ16();
+    r.tare_raw = sc_->tareRaw();
+    r.tau_ms = tau_.ms;
+    r.profile = profiles_.activeIndex();
+    telem_->beginRun(r);
+}
+
+void Controller::confirmProfile() {
+    if (picked_ != profiles_.activeIndex()) {
+        profiles_.select(picked_);
+        storage::saveProfiles(profiles_);
+    }
+    // show what will be dosed next
+    state_ = AppState::SHOW_SETPOINT;
+    tShowUntil_ = monoUs() + msToUs(SHOW_SP_MS);
 }
 
 void Controller::update() {
     // --- update peripherals ---
     sc_->update();
-    enc_->update();
-    btn_->update();
+    {
+        PROF_SCOPE(HID);
+        enc_->update();
+        btn_->update();
+    }
 
     // persistent across calls
-    static uint32_t hintUntil = 0;      // transient UI hint window
+    static uint64_t hintUntil = 0;      // transient UI hint window
     static int32_t cal_raw0 = 0;        // calibration zero point raw
-    static uint32_t resetKvUntil = 0;   // transient reset message window
+    static uint64_t resetKvUntil = 0;   // transient reset message window
 
     // --- long-press: enter/advance calibration (requires stability) ---
     if (enc_->buttonLongPress()) {
         if (REQUIRE_STABLE_FOR_CAL && !sc_->isStable()) {
-            hintUntil = millis() + HINT_HOLD_MS;  // show HOLD
+            hintUntil = monoUs() + msToUs(HINT_HOLD_MS);  // show HOLD
         } else if (state_ == AppState::IDLE ||
                    state_ == AppState::SHOW_SETPOINT) {
             // Capture zero point and move to span prompt
@@ -46,102 +333,203 @@ void Controller::update() {
             sc_->setCalMgPerCountQ16(mg_per_count_q16);
             storage::saveCalQ16(mg_per_count_q16);
 
-            // Reset learned velocity term; calibration changes mg/count
-            k_v_mg_per_gps_ = 0.0f;
-            storage::saveKv(0.0f);
+            // Corrections are in mg and survive; only shake their confidence
+            // so the next runs re-adapt quickly to the new mg/count
+            for (uint8_t i = 0; i < ProfileStore::kCount; ++i)
+                profiles_.at(i).ot.weaken();
+            storage::saveProfiles(profiles_);
 
             // brief done screen
             state_ = AppState::DONE_HOLD;
             done_from_cal_ = true;
 
-            tCalDoneUntil_ = millis() + DONE_HOLD_MS;
+            tCalDoneUntil_ = monoUs() + msToUs(DONE_HOLD_MS);
         }
     }
 
-    // --- handle encoder setpoint ---
+    // --- handle encoder: profile pick or setpoint ---
     int32_t dmg = enc_->consumeDeltaMg();
-    if (dmg != 0) {
+    int32_t detents = enc_->consumeDetents();
+    if (state_ == AppState::PROFILE_SELECT) {
+        if (detents != 0) {
+            // one slot per detent, wrapping around
+            int32_t n = ProfileStore::kCount;
+            picked_ = (uint8_t)(((picked_ + detents) % n + n) % n);
+            tShowUntil_ = monoUs() + msToUs(PROFILE_SELECT_MS);
+        }
+    } else if (dmg != 0) {
+        int32_t& sp = profiles_.active().setpoint_mg;
         int32_t maxMg = lround_mg(SETPOINT_MAX_G);
-        setpoint_mg_ = clamp_i32(setpoint_mg_ + dmg, 0, maxMg);
-        tShowUntil_ = millis() + SHOW_SP_MS;
+        sp = clamp_i32(sp + dmg, 0, maxMg);
+        tShowUntil_ = monoUs() + msToUs(SHOW_SP_MS);
         if (state_ == AppState::IDLE) state_ = AppState::SHOW_SETPOINT;
+        setpoint_dirty_ = true;
     }
 
+    // --- picker confirms itself when left alone ---
+    if (state_ == AppState::PROFILE_SELECT && monoUs() > tShowUntil_)
+        confirmProfile();
+
     // --- save setpoint when user stops turning (on timeout exit) ---
-    if (state_ == AppState::SHOW_SETPOINT && millis() > tShowUntil_) {
+    if (state_ == AppState::SHOW_SETPOINT && monoUs() > tShowUntil_) {
         state_ = AppState::IDLE;
-        storage::saveSetpointMg(setpoint_mg_);
+        if (setpoint_dirty_) storage::saveProfiles(profiles_);
+        setpoint_dirty_ = false;
     }
 
-    // --- tare (short press) ---
-    if (enc_->buttonShortPress()) {
-        bool measuring = (state_ == AppState::MEASURING);
+    // --- encoder click: confirm profile pick, else tare ---
+    bool click = enc_->buttonShortPress();
+    if (click && state_ == AppState::PROFILE_SELECT) {
+        confirmProfile();
+    } else if (click) {
+        bool measuring = (state_ == AppState::MEASURING ||
+                          state_ == AppState::TOPUP_SETTLE ||
+                          state_ == AppState::TOPUP_PULSE);
         if (measuring) {
-            hintUntil = millis() + HINT_HOLD_MS;  // blocked during measuring
+            hintUntil = monoUs() + msToUs(HINT_HOLD_MS);  // blocked during measuring
         } else if (!REQUIRE_STABLE_FOR_TARE || sc_->isStable()) {
             sc_->tare();
             storage::saveTareRaw(sc_->tareRaw());
         } else {
-            hintUntil = millis() + HINT_HOLD_MS;  // ask user to hold still
+            hintUntil = monoUs() + msToUs(HINT_HOLD_MS);  // ask user to hold still
         }
     }
 
     // --- start/stop ---
+    // --- profile picker (long press); long press inside it resets learning ---
     if (btn_->longPress()) {
-        k_v_mg_per_gps_ = 0.0f;
-        storage::saveKv(0.0f);
-        resetKvUntil = millis() + SHOW_SP_MS;
+        if (state_ == AppState::IDLE || state_ == AppState::SHOW_SETPOINT) {
+            if (state_ == AppState::SHOW_SETPOINT && setpoint_dirty_) {
+                storage::saveProfiles(profiles_);
+                setpoint_dirty_ = false;
+            }
+            picked_ = profiles_.activeIndex();
+            state_ = AppState::PROFILE_SELECT;
+            tShowUntil_ = monoUs() + msToUs(PROFILE_SELECT_MS);
+        } else if (state_ == AppState::PROFILE_SELECT) {
+            profiles_.at(picked_).ot.clear();
+            storage::saveProfiles(profiles_);
+            resetKvUntil = monoUs() + msToUs(SHOW_SP_MS);
+            tShowUntil_ = monoUs() + msToUs(PROFILE_SELECT_MS);
+        }
     }
 
     if (btn_->shortPress()) {
-        if (state_ == AppState::MEASURING) {
-            rel_->set(false);
+        if (state_ == AppState::PROFILE_SELECT) {
+            confirmProfile();
+        } else if (state_ == AppState::MEASURING) {
+            cutoff_us_ = relayOff(0);
+            onset_.cancel();
+            approach_ = false;
             state_ = AppState::DONE_HOLD;
             done_from_cal_ = false;
             stopped_manually_ = true;
 
-            tMeasureDoneUntil_ = millis() + DONE_HOLD_MS;
+            tMeasureDoneUntil_ = monoUs() + msToUs(DONE_HOLD_MS);
+        } else if (state_ == AppState::TOPUP_SETTLE ||
+                   state_ == AppState::TOPUP_PULSE) {
+            // cancel topping up, keep what is in the cup
+            endTopUp();
         } else if (state_ == AppState::IDLE ||
                    state_ == AppState::SHOW_SETPOINT) {
             // start
+            if (trace_) startTrace();
+            if (telem_) startTelemetry();
             rel_->set(true);
+            if (trace_) trace_->relay(monoUs(), true);
             sc_->setSamplePeriodMs(HX711_PERIOD_FAST_MS);
+            flow_.reset();
+            flow_avg_mgps_ = 0.0f;
+            flow_avg_t_us_ = 0;
+            topup_n_ = 0;
+            stop_latch_.reset();
+            approach_ = false;
             state_ = AppState::MEASURING;
             stopped_manually_ = false;
-            tMeasureUntil_ = millis() + MEASURE_TIMEOUT_MS;
+            tMeasureUntil_ = monoUs() + msToUs(MEASURE_TIMEOUT_MS);
         } else if (state_ == AppState::CAL_SPAN) {
             // allow abort of calibration with start button
             state_ = AppState::IDLE;
         }
     }
 
-    // --- dynamic cutoff during measuring ---
-    if (state_ == AppState::MEASURING) {
-        float v = sc_->vHatMgps();   // mg/s
-        float a = sc_->aHatMgps2();  // mg/s^2
-        float tau = (TAU_MEAS_MS + TAU_COMM_MS) / 1000.0f;  // s
-        // dynamic offset (mg)
-        float offset_dyn =
-            v * tau + 0.5f * a * tau * tau + k_v_mg_per_gps_ * (v / 1000.0f);
-        int32_t effective = setpoint_mg_ - (int32_t)lroundf(offset_dyn);
-
-        bool timed_out = millis() > tMeasureUntil_;
-        if (sc_->fastMg() + HYSTERESIS_MG >= effective || timed_out) {
-            // capture v at stop for learning
-            last_v_stop_gps_ = sc_->flowGps();
-            rel_->set(false);
-            state_ = AppState::DONE_HOLD;
-            done_from_cal_ = false;
-            timed_out_ = timed_out;
+    // --- cutoff timer switched the relay off since the last update ---
+    if (state_ == AppState::MEASURING && cutoff_timer_.fired()) stopTimed();
+
+    // --- consume every new sample exactly once ---
+    Scale::SampleRing& ring = sc_->samples();
+    while (const Scale::Sample* smp = ring.front()) {
+        PROF_SCOPE(CUTOFF);
+        // sequence gap => the ring overflowed and samples were dropped
+        uint32_t lost = 0;
+        if (last_seq_ != 0 && smp->seq != last_seq_ + 1)
+            lost = smp->seq - last_seq_ - 1;
+        missed_samples_ += lost;
+        last_seq_ = smp->seq;
+
+        if (trace_ && trace_->recording())
+            trace_->sample(smp->t_us, hxCounts(*smp));
 
-            tMeasureDoneUntil_ = millis() + DONE_HOLD_MS;
+        // flow decay after the stop, until its onset is found
+        if (state_ == AppState::DONE_HOLD && onset_.active())
+            onset_.feed(smp->t_us, sampleMg(*smp));
+
+        // dynamic cutoff during measuring
+        if (state_ == AppState::MEASURING) {
+            flow_.push(smp->t_us, sampleMg(*smp));
+            trackFlow(*smp);
+            // the sampling task may have cut on this sample already
+            bool cut = fast_cut_.fired() &&
+                       (int32_t)(smp->seq - fast_cut_.firedSeq()) >= 0;
+            bool stop = cut || cutoffReached(*smp);
+            float lead = 0.0f;
+            if (stop) {
+                stopRun(stopFlowMgps(smp->v_mgps) / 1000.0f, false,
+                        smp->t_us);
+                if (telem_) lead = leadMg(smp->v_mgps);
+            } else {
+                if (tuning_.cutoff_timer) scheduleCutoff(*smp);
+                if (!approach_ && tuning_.approach_mg > 0 &&
+                    remainingMg(*smp) <= tuning_.approach_mg) {
+                    // last grams: start duty cycling, first period on
+                    approach_ = true;
+                    approach_on_ = true;
+                    approach_t0_us_ = monoUs();
+                }
+                lead = leadMg(smp->v_mgps);
+                armFastCutoff(lead);
+            }
+            if (telem_) {
+                uint8_t fl =
+                    (rel_->isOn() ? TelemetryLog::RELAY : 0) |
+                    (approach_ ? TelemetryLog::APPROACH : 0) |
+                    (stop ? TelemetryLog::STOP : 0) |
+                    (cut ? TelemetryLog::FAST : 0) |
+                    (cutoff_timer_.armed() ? TelemetryLog::TIMER : 0) |
+                    (tuning_.engine == CutoffEngine::LSQ && flow_.ready()
+                         ? TelemetryLog::LSQ
+                         : 0);
+                telem_->sample(smp->t_us, lost > 255 ? 255 : lost, smp->raw,
+                               smp->x_mg, smp->v_mgps, smp->a_mgps2, lead,
+                               fl);
+            }
         }
+        ring.pop();
+    }
+
+    // --- slow approach: duty-cycle the relay near the target ---
+    if (state_ == AppState::MEASURING && approach_) updateApproach();
+
+    // --- safety timeout (also fires if samples stop arriving) ---
+    if (state_ == AppState::MEASURING && monoUs() > tMeasureUntil_) {
+        stopRun(sc_->flowGps(), true, 0);
     }
 
     // --- learning at end of run ---
-    uint32_t tDoneUntil_ = done_from_cal_ ? tCalDoneUntil_ : tMeasureDoneUntil_;
+    uint64_t tDoneUntil_ = done_from_cal_ ? tCalDoneUntil_ : tMeasureDoneUntil_;
 
-    if (state_ == AppState::DONE_HOLD && millis() > tDoneUntil_) {
+    if (state_ == AppState::DONE_HOLD && monoUs() > tDoneUntil_) {
+        bool topup = false;
         if (!done_from_cal_) {
             if (!stopped_manually_ && !timed_out_) {
                 // compute overshoot (mg) using slow/stable reading
@@ -150,57 +538,98 @@ void Controller::update() {
                 // Using fastMg for control
                 // int32_t final_mg = sc_->fastMg();
 
-                // error and flow rate at the end of the run
-                int32_t eps_mg = final_mg - setpoint_mg_;
+                // error and flow rate at the end of the run; the error is
+                // what the current correction left over, so it adds on
+                Profile& p = profiles_.active();
+                int32_t eps_mg = final_mg - p.setpoint_mg;
                 float v = fabsf(last_v_stop_gps_);
-                if (v < V_MIN_GPS) v = V_MIN_GPS;
-
-                // Update k_v (mg per g/s) with EMA toward eps/v
-                float target_kv = (float)eps_mg / v;
-                k_v_mg_per_gps_ = (1.0f - KV_EMA_ALPHA) * k_v_mg_per_gps_ +
-                                  KV_EMA_ALPHA * target_kv;
-                storage::saveKv(k_v_mg_per_gps_);
+                if (v >= V_MIN_GPS) {
+                    // Latency first. Its change moves the flow-proportional
+                    // share out of the tables and out of this run's error,
+                    // so the two are not corrected twice
+                    float e = (float)eps_mg;
+                    float tau_ms;
+                    if (tuning_.learn_tau && onset_.measureMs(tau_ms)) {
+                        float before = tau_.ms;
+                        tau_.learn(tau_ms);
+                        float d = tau_.ms - before;
+                        // every profile's table shares the actuator
+                        for (uint8_t i = 0; i < ProfileStore::kCount; ++i)
+                            profiles_.at(i).ot.shiftForLatency(d);
+                        e -= onset_.vRef() * d / 1000.0f;
+                        storage::saveLatency(rel_->actuator(), tau_);
+                    }
+                    p.ot.learn(v, p.setpoint_mg, e, tuning_.ot_min_gain);
+                    storage::saveProfiles(profiles_);
+                }
+                // only automatic stops are topped up; a manual stop is
+                // what the user wanted, a timeout means no beans
+                topup = tuning_.topup_pulses > 0;
             }
 
-            // reset sampling back to idle rate
-            sc_->setSamplePeriodMs(HX711_PERIOD_IDLE_MS);
+            // reset sampling back to idle rate (top-up keeps the fast one)
+            if (!topup) sc_->setSamplePeriodMs(HX711_PERIOD_IDLE_MS);
+            // trace covers the run plus spin-down and settling
+            if (trace_) trace_->end();
+            if (telem_)
+                telem_->endRun(stopped_manually_ ? TelemetryLog::MANUAL
+                               : timed_out_      ? TelemetryLog::TIMEOUT
+                                                 : TelemetryLog::AUTO,
+                               sc_->filteredMg(), cutoff_us_);
         }
         done_from_cal_ = false;
         stopped_manually_ = false;
         timed_out_ = false;
         state_ = AppState::IDLE;
+        if (topup) {
+            topup_learned_ = false;
+            topup_from_mg_ = sc_->filteredMg();  // end-of-run mass
+            state_ = AppState::TOPUP_SETTLE;
+            tTopUpMin_ = monoUs();
+            tTopUpUntil_ = monoUs() + msToUs(TOPUP_SETTLE_MAX_MS);
+        }
     }
 
-    // --- display throttle & overlay ---
-    if (millis() < hintUntil) {
-        disp_->showHintHold();
-        return;
-    }
-
-    if (millis() < resetKvUntil) {
-        disp_->showKvReset();
-        return;
-    }
+    // --- top-up pulses after an under-dose ---
+    updateTopUp();
 
+    // --- display: publish what to show; the display task renders it ---
     // Determine the relevant done timer for display
-    uint32_t tDisplayDoneUntil =
+    uint64_t tDisplayDoneUntil =
         done_from_cal_ ? tCalDoneUntil_ : tMeasureDoneUntil_;
 
-    uint32_t dispPeriod =
-        (state_ == AppState::MEASURING) ? DISPLAY_MEAS_MS : DISPLAY_IDLE_MS;
-    if (millis() < tDispNext_) return;
-    tDispNext_ = millis() + dispPeriod;
-
-    // --- display ---
-    if (!sc_->ok()) {
-        disp_->showError();
+    Display::View view;
+    view.measuring = state_ == AppState::MEASURING;
+    if (monoUs() < hintUntil) {
+        view.mode = Display::View::Mode::HINT_HOLD;
+    } else if (monoUs() < resetKvUntil) {
+        view.mode = Display::View::Mode::KV_RESET;
+    } else if (!sc_->ok()) {
+        view.mode = Display::View::Mode::ERROR;
+    } else if (state_ == AppState::PROFILE_SELECT) {
+        view.mode = Display::View::Mode::PROFILE;
+        view.profile = picked_ + 1;
+        strncpy(view.name, profiles_.at(picked_).name, sizeof view.name - 1);
     } else if (state_ == AppState::SHOW_SETPOINT) {
-        disp_->showSetpointMg(setpoint_mg_);
+        view.mode = Display::View::Mode::SETPOINT;
+        view.setpoint_mg = profiles_.active().setpoint_mg;
     } else if (state_ == AppState::CAL_SPAN) {
-        disp_->showCalSpan();
-    } else if (state_ == AppState::DONE_HOLD && millis() < tDisplayDoneUntil) {
-        disp_->showCalDone();
-    } else {  // IDLE/MEASURING
-        disp_->showWeightMg(sc_->filteredMg(), sc_->isStable());
+        view.mode = Display::View::Mode::CAL_SPAN;
+    } else if (state_ == AppState::DONE_HOLD && monoUs() < tDisplayDoneUntil) {
+        view.mode = Display::View::Mode::CAL_DONE;
+    } else {  // IDLE/MEASURING/TOPUP_*
+        view.mode = Display::View::Mode::WEIGHT;
+        view.weight_mg = sc_->filteredMg();
+        view.stable = sc_->isStable();
+    }
+    if (view.measuring) {
+        // status module: averaged flow and the straight-line time to the
+        // setpoint at that flow, which reads steadier than the fit's
+        float eta_s = FlowPredictor::timeTo(
+            {(float)sc_->filteredMg(), flow_avg_mgps_, 0.0f},
+            (float)profiles_.active().setpoint_mg);
+        view.flow_mgps = (int32_t)flow_avg_mgps_;
+        view.eta_ms = eta_s < 600.0f ? (int32_t)(eta_s * 1000.0f) : -1;
     }
+    disp_->publish(view);
 }
@@ -0,0 +1,44 @@
+#include "cutoff_timer.h"
+
+#include "timebase.h"
+
+bool CutoffTimer::begin(Relay* rel, StopLatch* latch) {
+    rel_ = rel;
+    latch_ = latch;
+    // task dispatch: Relay::set may queue a WiFi request, not ISR-safe
+    esp_timer_create_args_t args = {};
+    args.callback = &CutoffTimer::onFire;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "cutoff";
+    return esp_timer_create(&args, &timer_) == ESP_OK;
+}
+
+void CutoffTimer::arm(uint64_t at_us) {
+    if (!timer_ || latch_->claimed()) return;
+    esp_timer_stop(timer_);  // ESP_ERR_INVALID_STATE if idle: fine
+    uint64_t now = monoUs();
+    esp_timer_start_once(timer_, at_us > now ? at_us - now : 1);
+    armed_ = true;
+}
+
+void CutoffTimer::cancel() {
+    // a shot that already fired stays visible until clear()
+    if (fired()) return;
+    if (timer_ && armed_) esp_timer_stop(timer_);
+    armed_ = false;
+}
+
+void CutoffTimer::clear() {
+    armed_ = false;
+    fired_.store(false, std::memory_order_relaxed);
+}
+
+void CutoffTimer::onFire(void* self) {
+    CutoffTimer* t = static_cast<CutoffTimer*>(self);
+    if (!t->latch_->claim(StopLatch::TIMER)) return;  // the fast path was first
+    // other esp_timer callbacks wait behind this one; loop() repeats it
+    t->rel_->trySet(false);
+    t->fired_us_ = monoUs();
+    t->fired_.store(true, std::memory_order_release);
+}
@@ -1,27 +1,132 @@
 #include "display.h"
 
+#include <string.h>
+
 #include "config.h"
+#include "logging.h"
+#include "profiler.h"
+#include "timebase.h"
 
 void Display::begin(uint8_t din, uint8_t clk, uint8_t cs) {
-    lc_ = LedControl(din, clk, cs, 1);
-    lc_.shutdown(0, false);
-    lc_.setIntensity(0, DISPLAY_INTENSITY);
-    lc_.clearDisplay(0);
+    lc_.begin(din, clk, cs, DISPLAY_MODULES, DISPLAY_SPI_HOST);
+    for (uint8_t m = 0; m < DISPLAY_MODULES; m++) {
+        lc_.shutdown(m, false);
+        lc_.setIntensity(m, DISPLAY_INTENSITY);
+        lc_.clearDisplay(m);
+    }
+}
+
+void Display::startTask() {
+    if (task_) return;
+    if (xTaskCreatePinnedToCore(taskThunk, "Display", DISPLAY_TASK_STACK, this,
+                                DISPLAY_TASK_PRIORITY, &task_,
+                                DISPLAY_TASK_CORE) != pdPASS)
+        task_ = nullptr;
+}
+
+void Display::taskThunk(void* arg) {
+    Display* self = static_cast<Display*>(arg);
+    for (;;) vTaskDelay(pdMS_TO_TICKS(self->renderLatest()));
+}
+
+void Display::update() {
+    if (task_) return;
+    uint64_t now = monoUs();
+    if (now < next_frame_us_) return;
+    next_frame_us_ = now + msToUs(renderLatest());
+}
+
+uint32_t Display::renderLatest() {
+    if (const View* v = views_.take()) {
+        PROF_SCOPE(DISPLAY);
+        render(*v);
+        measuring_ = v->measuring;
+    }
+    return measuring_ ? DISPLAY_MEAS_MS : DISPLAY_IDLE_MS;
+}
+
+void Display::render(const View& v) {
+    status_on_ = DISPLAY_MODULES > 1 && v.measuring;
+    flow_mgps_ = v.flow_mgps;
+    eta_ms_ = v.eta_ms;
+    switch (v.mode) {
+        case View::Mode::SETPOINT: showSetpointMg(v.setpoint_mg); break;
+        case View::Mode::PROFILE: showProfile(v.profile, v.name); break;
+        case View::Mode::ERROR: showError(); break;
+        case View::Mode::CAL_SPAN: showCalSpan(); break;
+        case View::Mode::CAL_DONE: showCalDone(); break;
+        case View::Mode::HINT_HOLD: showHintHold(); break;
+        case View::Mode::KV_RESET: showKvReset(); break;
+        default: showWeightMg(v.weight_mg, v.stable); break;
+    }
 }
 
 int Display::mapDigit(int d) const {
     return DISPLAY_RIGHT_TO_LEFT ? d : (7 - d);
 }
 
-void Display::putChar(int pos, char c, bool dp) {
-    lc_.setChar(0, mapDigit(pos), c, dp);
+void Display::putChar(int pos, char c, bool dp) { putCharAt(0, pos, c, dp); }
+void Display::putCharAt(uint8_t module, int pos, char c, bool dp) {
+    fb_[module * 8 + mapDigit(pos)] = LedControl::charSegments(c, dp);
 }
 void Display::putDigit(int pos, uint8_t d, bool dp) {
-    lc_.setChar(0, mapDigit(pos), char('0' + (d % 10)), dp);
+    putChar(pos, char('0' + (d % 10)), dp);
+}
+
+void Display::beginFrame() {
+    memset(fb_, 0, sizeof fb_);
+    if (status_on_) renderStatus();
+}
+
+void Display::flush() {
+    // LedControl keeps what each digit currently shows; send only the
+    // digits that differ, so an unchanged frame costs no bus traffic. A
+    // changed digit goes to all modules in one transfer: the chain is
+    // shifted through in full for any register write anyway.
+    uint8_t row_vals[DISPLAY_MODULES];
+    for (int row = 0; row < 8; row++) {
+        bool changed = false;
+        for (uint8_t m = 0; m < DISPLAY_MODULES; m++) {
+            row_vals[m] = fb_[m * 8 + row];
+            changed |= row_vals[m] != lc_.getRow(m, row);
+        }
+        if (changed) lc_.setRowAll(row, row_vals);
+    }
 }
 
 void Display::clear() {
-    for (int i = 0; i < 8; i++) putChar(i, ' ');
+    beginFrame();
+    flush();
+}
+
+void Display::renderTenths(uint8_t module, int pos, int width,
+                           int32_t tenths) {
+    // ##.# right-aligned in digits pos..pos+width-1, clamped to fit
+    int32_t max = 1;
+    for (int i = 0; i < width; i++) max *= 10;
+    if (tenths < 0) tenths = 0;
+    if (tenths > max - 1) tenths = max - 1;
+    int end = pos + width;
+    putCharAt(module, pos++, char('0' + tenths % 10));
+    tenths /= 10;
+    putCharAt(module, pos++, char('0' + tenths % 10), true);
+    tenths /= 10;
+    while (tenths > 0 && pos < end) {
+        putCharAt(module, pos++, char('0' + tenths % 10));
+        tenths /= 10;
+    }
+}
+
+void Display::renderStatus() {
+    // Second module: flow in g/s on the left half, seconds to the
+    // setpoint on the right, e.g. " 2.4 10.5"
+    renderTenths(1, 4, 4, (flow_mgps_ + 50) / 100);
+    if (eta_ms_ < 0) {
+        putCharAt(1, 1, '-');
+        putCharAt(1, 0, '-');
+    } else {
+        renderTenths(1, 0, 4, (eta_ms_ + 50) / 100);
+    }
 }
 
 void Display::renderNumberMg(int32_t mg) {
@@ -47,84 +152,103 @@ void Display::renderNumberMg(int32_t mg) {
 }
 
 void Display::showWeightMg(int32_t mg, bool stable) {
-    clear();
+    beginFrame();
     renderNumberMg(mg);
     // Use leftmost DP as stability indicator
     putChar(7, ' ', stable);
 
-    // Serial.printf("Display: %s %d mg\n", stable ? "stable" : "unstable", mg);
+    LOGF(DEBUG, DISPLAY, "Display: %s %ld mg", stable ? "stable" : "unstable",
+         (long)mg);
+    flush();
 }
 
 void Display::showSetpointMg(int32_t mg) {
-    clear();
+    beginFrame();
     putChar(7, 'S');
     putChar(6, 'P');
     renderNumberMg(mg);
+    flush();
+}
+
+void Display::showProfile(uint8_t number, const char* name) {
+    beginFrame();
+    putChar(7, 'P');
+    putDigit(6, number);
+    for (int i = 0; i < 4 && name[i]; i++) putChar(3 - i, name[i]);
+    flush();
 }
 
 void Display::showError() {
-    clear();
+    beginFrame();
     putChar(7, 'E');
     putChar(6, 'r');
     putChar(5, 'r');
+    flush();
 }
 
 void Display::showCalZero() {
-    clear();
+    beginFrame();
     putChar(7, 'C');
     putChar(6, 'A');
     putChar(5, 'L');
     putChar(4, '0');
+    flush();
 }
 void Display::showCalSpan() {
-    clear();
+    beginFrame();
     putChar(7, 'S');
     putChar(6, 'P');
     putChar(5, 'A');
     putChar(4, 'n');
+    flush();
 }
 void Display::showCalDone() {
-    clear();
+    beginFrame();
     putChar(7, 'd');
     putChar(6, 'o');
     putChar(5, 'n');
     putChar(4, 'E');
+    flush();
 }
 void Display::showHintHold() {
-    clear();
+    beginFrame();
     putChar(7, 'H');
     putChar(6, 'o');
     putChar(5, 'L');
     putChar(4, 'd');
+    flush();
 }
 void Display::showKvReset() {
-    clear();
+    beginFrame();
     putChar(7, 'r');
     putChar(6, 'E');
     putChar(5, 'S');
     putChar(4, 'E');
     putChar(3, 't');
+    flush();
 }
 void Display::showStartup() {
-    clear();
+    beginFrame();
     putChar(7, 'C');
     putChar(6, 'o');
     putChar(5, 'f');
     putChar(4, 'f');
     putChar(3, 'e');
     putChar(2, 'e');
+    flush();
 }
 void Display::showWifiConnecting(const int attempt) {
-    clear();
+    beginFrame();
     putChar(7, 'A');
     putChar(6, 'i');
     putChar(5, 'r');
     putChar(4, ' ');
     for (int i = 0; i < attempt && i < 4; i++)
         putChar(3 - i, '.');
+    flush();
 }
 void Display::showWifiConnected() {
-    clear();
+    beginFrame();
     putChar(7, 'C');
     putChar(6, 'o');
     putChar(5, 'n');
@@ -133,4 +257,5 @@ void Display::showWifiConnected() {
     putChar(2, 'C');
     putChar(1, 't');
     putChar(0, 'd');
+    flush();
 }
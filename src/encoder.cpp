@@ -1,6 +1,8 @@
 #include "encoder.h"
 
 #include "config.h"
+#include "logging.h"
+#include "timebase.h"
 #include "utils.h"
 
 Encoder::Encoder(uint32_t buttonLongPressMs) : button_(buttonLongPressMs) {}
@@ -24,10 +26,10 @@ void Encoder::update() {
     int d = tab[prev_][s];
     prev_ = s;
     if (d != 0) {
-        uint32_t now = millis();
-        float dt = (now - lastTickMs_) / 1000.0f;
+        uint64_t now = monoUs();
+        float dt = (now - lastTickUs_) * 1e-6f;
         if (dt <= 0) dt = 0.001f;
-        lastTickMs_ = now;
+        lastTickUs_ = now;
         emaDt_ = 0.7f * emaDt_ + 0.3f * dt;
         float tps = 1.0f / emaDt_;
         float step_g = ENC_STEP_SLOW_G;
@@ -37,8 +39,10 @@ void Encoder::update() {
             step_g = ENC_STEP_MED_G;
         int32_t step_mg = lround_mg(step_g);
         delta_mg_ += (d > 0 ? +step_mg : -step_mg);
+        steps_ += d;
 
-        // Serial.printf("Enc: d=%d tps=%.1f step=%.1f g dt=%.3f s\n", d, tps, step_g, dt);
+        LOGF(DEBUG, ENCODER, "Enc: d=%d tps=%.1f step=%.1f g dt=%.3f s", d,
+             tps, step_g, dt);
     }
 
     // --- SW debounce & press type ---
@@ -51,6 +55,12 @@ int32_t Encoder::consumeDeltaMg() {
     return d;
 }
 
+int32_t Encoder::consumeDetents() {
+    int32_t n = steps_ / ENC_STEPS_PER_DETENT;  // keep the partial detent
+    steps_ -= n * ENC_STEPS_PER_DETENT;
+    return n;
+}
+
 bool Encoder::buttonShortPress() { return button_.shortPress(); }
 
 bool Encoder::buttonLongPress() { return button_.longPress(); }
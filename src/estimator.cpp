@@ -0,0 +1,170 @@
+#include "estimator.h"
+
+#include <math.h>
+
+// ---------------- α–β ----------------
+
+void AlphaBetaEstimator::setGains(float g, float h) {
+    g_ = g;
+    h_ = h;
+    for (Coef& c : tab_) c.bucket = UINT32_MAX;  // h/dt is stale
+}
+
+const AlphaBetaEstimator::Coef& AlphaBetaEstimator::coef(uint32_t dt_us) {
+    uint32_t b = dt_us >> EST_DT_BUCKET_SHIFT;
+    if (last_->bucket == b) return *last_;  // same rate as last sample
+    Coef& c = tab_[b % EST_DT_SLOTS];
+    last_ = &c;
+    if (c.bucket != b) {  // new rate: the only divisions, once per bucket
+        c.bucket = b;
+        c.dt = dt_us * 1e-6f;
+        c.h_dt = h_ / c.dt;
+        c.ema_a_dt = 0.2f / c.dt;
+    }
+    return c;
+}
+
+void AlphaBetaEstimator::update(float z, uint32_t dt_us) {
+    const Coef& c = coef(dt_us);
+    // predict
+    float x_pred = x_ + v_ * c.dt;
+    float v_pred = v_;
+    // update
+    float r = z - x_pred;
+    x_ = x_pred + g_ * r;
+    v_ = v_pred + c.h_dt * r;
+    // accel estimate (EMA of dv/dt)
+    a_ = 0.8f * a_ + c.ema_a_dt * (v_ - last_v_);
+    last_v_ = v_;
+}
+
+// ---------------- Kalman, full covariance ----------------
+
+void KalmanCaFull::init(float z) {
+    s_[0] = z;
+    s_[1] = 0.0f;
+    s_[2] = 0.0f;
+    // unknown flow: wide priors on v and a so the first samples take over
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j) P_[i][j] = 0.0f;
+    P_[0][0] = n_.r_mg2;
+    P_[1][1] = 1e7f;   // (~3 g/s)^2
+    P_[2][2] = 1e8f;   // (~10 g/s^2)^2
+    init_ = true;
+}
+
+void KalmanCaFull::predictCov(float dt) {
+    // P = F P F^T + Q
+    const float dt2 = dt * dt;
+    const float F[3][3] = {{1.0f, dt, 0.5f * dt2},
+                           {0.0f, 1.0f, dt},
+                           {0.0f, 0.0f, 1.0f}};
+    float FP[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            FP[i][j] = F[i][0] * P_[0][j] + F[i][1] * P_[1][j] +
+                       F[i][2] * P_[2][j];
+
+    // discretised white-jerk noise
+    const float q = n_.q_jerk;
+    const float dt3 = dt2 * dt, dt4 = dt3 * dt, dt5 = dt4 * dt;
+    const float Q[3][3] = {{q * dt5 / 20.0f, q * dt4 / 8.0f, q * dt3 / 6.0f},
+                           {q * dt4 / 8.0f, q * dt3 / 3.0f, q * dt2 / 2.0f},
+                           {q * dt3 / 6.0f, q * dt2 / 2.0f, q * dt}};
+    for (int i = 0; i < 3; ++i)
+        for (int j = i; j < 3; ++j) {
+            float p = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] +
+                      FP[i][2] * F[j][2] + Q[i][j];
+            P_[i][j] = P_[j][i] = p;
+        }
+}
+
+void KalmanCaFull::gain(float K[3]) {
+    const float S = P_[0][0] + n_.r_mg2;
+    K[0] = P_[0][0] / S;
+    K[1] = P_[1][0] / S;
+    K[2] = P_[2][0] / S;
+}
+
+void KalmanCaFull::updateCov(const float K[3]) {
+    // P = (I - K H) P, kept symmetric
+    const float row0[3] = {P_[0][0], P_[0][1], P_[0][2]};
+    for (int i = 0; i < 3; ++i)
+        for (int j = i; j < 3; ++j) {
+            float p = P_[i][j] - K[i] * row0[j];
+            P_[i][j] = P_[j][i] = p;
+        }
+}
+
+void KalmanCaFull::update(float z, uint32_t dt_us) {
+    if (!init_) {
+        init(z);
+        return;
+    }
+    const float dt = dt_us * 1e-6f;
+
+    // ---- predict: s = F s ----
+    s_[0] += s_[1] * dt + 0.5f * s_[2] * dt * dt;
+    s_[1] += s_[2] * dt;
+    predictCov(dt);
+
+    // ---- update with z = x + noise ----
+    float K[3];
+    gain(K);
+    const float y = z - s_[0];
+    for (int i = 0; i < 3; ++i) s_[i] += K[i] * y;
+    updateCov(K);
+}
+
+void KalmanCaFull::steadyGain(const Noise& n, float dt, float K[3]) {
+    KalmanCaFull kf;
+    kf.setNoise(n);
+    kf.init(0.0f);
+    float prev = -1.0f;
+    for (int i = 0; i < 2000; ++i) {
+        kf.predictCov(dt);
+        kf.gain(K);
+        kf.updateCov(K);
+        if (fabsf(K[0] - prev) < 1e-7f) break;
+        prev = K[0];
+    }
+}
+
+// ---------------- Kalman, steady-state gains ----------------
+
+void KalmanCaEstimator::setNoise(const Noise& n) {
+    if (n.q_jerk == n_.q_jerk && n.r_mg2 == n_.r_mg2) return;
+    n_ = n;
+    for (Coef& c : tab_) c.bucket = UINT32_MAX;
+}
+
+const KalmanCaEstimator::Coef& KalmanCaEstimator::coef(uint32_t dt_us) {
+    uint32_t b = dt_us >> EST_DT_BUCKET_SHIFT;
+    if (last_->bucket == b) return *last_;  // same rate as last sample
+    Coef& c = tab_[b % EST_DT_SLOTS];
+    last_ = &c;
+    if (c.bucket != b) {  // new rate or noise: solve for its gains once
+        c.bucket = b;
+        c.dt = dt_us * 1e-6f;
+        c.half_dt2 = 0.5f * c.dt * c.dt;
+        KalmanCaFull::steadyGain(n_, c.dt, c.K);
+    }
+    return c;
+}
+
+void KalmanCaEstimator::update(float z, uint32_t dt_us) {
+    if (!init_) {
+        s_[0] = z;
+        init_ = true;
+        return;
+    }
+    const Coef& c = coef(dt_us);
+    // predict
+    float x = s_[0] + s_[1] * c.dt + s_[2] * c.half_dt2;
+    float v = s_[1] + s_[2] * c.dt;
+    // correct
+    float y = z - x;
+    s_[0] = x + c.K[0] * y;
+    s_[1] = v + c.K[1] * y;
+    s_[2] += c.K[2] * y;
+}
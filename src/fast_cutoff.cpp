@@ -0,0 +1,47 @@
+#include "fast_cutoff.h"
+
+#include <algorithm>
+
+#include "config.h"
+#include "timebase.h"
+
+bool FastCutoff::check(uint32_t seq, uint64_t t_us, float x_mg, float v_mgps,
+                       float a_mgps2) {
+    if (!armed_.load(std::memory_order_acquire)) return false;
+    const float tau = TAU_MEAS_MS / 1000.0f;  // s
+    float x = x_mg + (v_mgps + 0.5f * a_mgps2 * tau) * tau;
+    if (x < threshold_mg_.load(std::memory_order_relaxed)) return false;
+    armed_.store(false, std::memory_order_relaxed);
+    if (!latch_->claim(StopLatch::FAST)) return false;  // the timer was first
+    // never wait on a full plug queue here; loop() repeats the off command
+    rel_->trySet(false);
+    uint64_t now = monoUs();
+    fired_seq_ = seq;
+    fired_us_ = now;
+    fired_lat_us_ = (uint32_t)(now - t_us);
+    fired_.store(true, std::memory_order_release);
+    return true;
+}
+
+void CutoffLatencyLog::record(Path p, uint32_t us) {
+    us_[p][next_[p]] = us;
+    next_[p] = (next_[p] + 1) % kKeep;
+    if (n_[p] < kKeep) n_[p]++;
+}
+
+bool CutoffLatencyLog::percentiles(Path p, uint32_t& p50, uint32_t& p90,
+                                   uint32_t& p99, uint32_t& max,
+                                   uint8_t& n) const {
+    n = n_[p];
+    if (n == 0) return false;
+    uint32_t v[kKeep];
+    std::copy(us_[p], us_[p] + n, v);
+    std::sort(v, v + n);
+    // nearest rank
+    auto at = [&](uint32_t pct) { return v[(pct * n + 99) / 100 - 1]; };
+    p50 = at(50);
+    p90 = at(90);
+    p99 = at(99);
+    max = v[n - 1];
+    return true;
+}
@@ -0,0 +1,115 @@
+#include "flow_predictor.h"
+
+#include <math.h>
+
+#include "timebase.h"
+
+FlowPredictor::FlowPredictor() {
+    // moments of j = -(N-1)..0
+    double S[5] = {0, 0, 0, 0, 0};
+    for (int32_t j = -(int32_t)(kN - 1); j <= 0; ++j) {
+        double p = 1.0;
+        for (int k = 0; k < 5; ++k, p *= j) S[k] += p;
+    }
+    for (int k = 0; k < 3; ++k) sj_[k] = (int64_t)S[k];
+    const double M[3][3] = {
+        {S[0], S[1], S[2]}, {S[1], S[2], S[3]}, {S[2], S[3], S[4]}};
+    // inverse of the symmetric 3x3 normal matrix via its adjugate
+    double c00 = M[1][1] * M[2][2] - M[1][2] * M[2][1];
+    double c01 = M[1][2] * M[2][0] - M[1][0] * M[2][2];
+    double c02 = M[1][0] * M[2][1] - M[1][1] * M[2][0];
+    double det = M[0][0] * c00 + M[0][1] * c01 + M[0][2] * c02;
+    double adj[3][3] = {
+        {c00, M[0][2] * M[2][1] - M[0][1] * M[2][2],
+         M[0][1] * M[1][2] - M[0][2] * M[1][1]},
+        {c01, M[0][0] * M[2][2] - M[0][2] * M[2][0],
+         M[0][2] * M[1][0] - M[0][0] * M[1][2]},
+        {c02, M[0][1] * M[2][0] - M[0][0] * M[2][1],
+         M[0][0] * M[1][1] - M[0][1] * M[1][0]}};
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c) inv_[r][c] = (float)(adj[r][c] / det);
+}
+
+void FlowPredictor::reset() {
+    head_ = n_ = 0;
+    s0_ = s1_ = s2_ = 0;
+}
+
+void FlowPredictor::push(uint64_t t_us, int32_t mg) {
+    const uint32_t t = (uint32_t)t_us;
+    // a missed conversion would put samples off the index grid
+    if (n_ && t - last_us_ > msToUs(2 * HX711_PERIOD_FAST_MS)) reset();
+    last_us_ = t;
+
+    // existing samples move one step back: j -> j-1
+    s2_ += s0_ - 2 * s1_;
+    s1_ -= s0_;
+
+    uint32_t i = head_ % kN;
+    if (n_ == kN) {  // oldest now sits at j = -N
+        const int64_t yo = y_[i];
+        s0_ -= yo;
+        s1_ += (int64_t)kN * yo;
+        s2_ -= (int64_t)kN * kN * yo;
+    } else {
+        n_++;
+    }
+    y_[i] = mg;
+    t_[i] = t;
+    head_++;
+    s0_ += mg;  // newest at j = 0 only contributes to Σy
+}
+
+FlowPredictor::Fit FlowPredictor::fit() const {
+    Fit f = {0.0f, 0.0f, 0.0f};
+    if (!ready()) return f;
+    // fit y - y_newest: the moments shrink to the window's variation and
+    // survive the conversion to float (exact int64 until then)
+    const int64_t ref = y_[(head_ - 1) % kN];
+    const float m[3] = {(float)(s0_ - ref * sj_[0]),
+                        (float)(s1_ - ref * sj_[1]),
+                        (float)(s2_ - ref * sj_[2])};
+    float c[3];
+    for (int r = 0; r < 3; ++r)
+        c[r] = inv_[r][0] * m[0] + inv_[r][1] * m[1] + inv_[r][2] * m[2];
+    c[0] += (float)ref;
+
+    // per-sample -> per-second with the window's mean spacing
+    uint32_t oldest = t_[head_ % kN];
+    uint32_t newest = t_[(head_ - 1) % kN];
+    float ts = (newest - oldest) * 1e-6f / (kN - 1);
+    if (ts <= 0.0f) return f;
+    float inv_ts = 1.0f / ts;
+    f.m = c[0];
+    f.v = c[1] * inv_ts;
+    f.a = 2.0f * c[2] * inv_ts * inv_ts;
+    return f;
+}
+
+bool FlowPredictor::reachesWithin(const Fit& f, float target_mg,
+                                  float horizon_s) {
+    if (f.m >= target_mg || f.at(horizon_s) >= target_mg) return true;
+    // a decelerating fit can peak inside the horizon
+    if (f.a < 0.0f && f.v > 0.0f) {
+        float t_peak = -f.v / f.a;
+        if (t_peak < horizon_s) return f.at(t_peak) >= target_mg;
+    }
+    return false;
+}
+
+float FlowPredictor::timeTo(const Fit& f, float target_mg) {
+    float d = target_mg - f.m;
+    if (d <= 0.0f) return 0.0f;
+    // 0.5 a τ² + v τ - d = 0, smallest positive root
+    float h = 0.5f * f.a;
+    if (fabsf(h) < 1e-6f) return f.v > 0.0f ? d / f.v : INFINITY;
+    float disc = f.v * f.v + 4.0f * h * d;
+    if (disc < 0.0f) return INFINITY;
+    float sq = sqrtf(disc);
+    float r1 = (-f.v + sq) / (2.0f * h);
+    float r2 = (-f.v - sq) / (2.0f * h);
+    float r = INFINITY;
+    if (r1 > 0.0f) r = r1;
+    if (r2 > 0.0f && r2 < r) r = r2;
+    return r;
+}
@@ -0,0 +1,93 @@
+#include "hx711_driver.h"
+
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+
+#include "config.h"
+
+bool Hx711::begin(uint8_t dtPin, uint8_t sckPin, Gain gain) {
+    dt_pin_ = dtPin;
+    sck_pin_ = sckPin;
+    gain_ = gain;
+
+    // SCK must idle low; high for >60 us powers the HX711 down
+    pinMode(sck_pin_, OUTPUT);
+    digitalWrite(sck_pin_, LOW);
+    pinMode(dt_pin_, INPUT);
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = -1;
+    bus.miso_io_num = dt_pin_;
+    bus.sclk_io_num = sck_pin_;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = 4;
+    spi_host_device_t host = (spi_host_device_t)HX711_SPI_HOST;
+    if (spi_bus_initialize(host, &bus, SPI_DMA_DISABLED) != ESP_OK)
+        return false;
+
+    // Mode 1: HX711 shifts DOUT on the rising edge, we sample on the falling
+    spi_device_interface_config_t dev = {};
+    dev.mode = 1;
+    dev.clock_speed_hz = HX711_SPI_HZ;
+    dev.spics_io_num = -1;
+    dev.queue_size = 1;
+    if (spi_bus_add_device(host, &dev, &dev_) != ESP_OK) return false;
+
+    trans_ = new spi_transaction_t();
+    busy_ = false;
+
+    // One readout applies the requested gain to the following conversion
+    int32_t discard;
+    read(discard);
+    return true;
+}
+
+bool Hx711::isReady() const { return digitalRead(dt_pin_) == LOW; }
+
+bool Hx711::startRead() {
+    if (!dev_ || busy_) return false;
+
+    // 24 data bits + 1..3 pulses selecting channel/gain of the next sample
+    size_t bits = 24 + (uint8_t)gain_;
+    *trans_ = spi_transaction_t();
+    trans_->flags = SPI_TRANS_USE_RXDATA;
+    trans_->length = bits;
+    trans_->rxlength = bits;
+
+    // DOUT toggles with the data bits; keep those edges away from the DRDY ISR
+    gpio_intr_disable((gpio_num_t)dt_pin_);
+    if (spi_device_queue_trans(dev_, trans_, 0) != ESP_OK) {
+        gpio_intr_enable((gpio_num_t)dt_pin_);
+        return false;
+    }
+    busy_ = true;
+    return true;
+}
+
+bool Hx711::completeRead(int32_t& out, uint32_t waitTicks) {
+    if (!busy_) return false;
+
+    spi_transaction_t* done = nullptr;
+    if (spi_device_get_trans_result(dev_, &done, waitTicks) != ESP_OK)
+        return false;
+    busy_ = false;
+    gpio_intr_enable((gpio_num_t)dt_pin_);
+
+    // MSB first; bits past the 24th are the gain pulses and carry no data
+    const uint8_t* rx = done->rx_data;
+    uint32_t v = ((uint32_t)rx[0] << 16) | ((uint32_t)rx[1] << 8) | rx[2];
+    if (v & 0x800000u) v |= 0xFF000000u;  // sign-extend 24-bit two's complement
+    out = (int32_t)v;
+    return true;
+}
+
+bool Hx711::read(int32_t& out) {
+    // a conversion takes at most 100 ms at 10 SPS; give up after a few
+    for (int i = 0; !isReady(); ++i) {
+        if (i >= 500) return false;
+        delay(1);
+    }
+    if (!startRead()) return false;
+    return completeRead(out, portMAX_DELAY);
+}
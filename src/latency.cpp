@@ -0,0 +1,86 @@
+#include "latency.h"
+
+#include <math.h>
+#include <stdio.h>
+
+void DecayOnsetProbe::begin(uint64_t off_us, float v_ref_mgps) {
+    off_us_ = off_us;
+    v_ref_ = v_ref_mgps >= V_MIN_GPS * 1000.0f ? v_ref_mgps : 0.0f;
+    n_ = 0;
+    head_ = 0;
+    prev_ms_ = 0.0f;
+    prev_v_ = v_ref_;
+    hi_ms_ = -1.0f;
+    ms_ = -1.0f;
+    done_ = false;
+}
+
+void DecayOnsetProbe::feed(uint64_t t_us, int32_t mg) {
+    if (!active() || t_us <= off_us_) return;
+    float t_ms = (float)(t_us - off_us_) / 1000.0f;
+    if (t_ms > (float)TAU_COMM_MAX_MS) {
+        done_ = true;  // never slowed down: no usable stop
+        return;
+    }
+    // window of the last kWindow readings; its middle gets the flow
+    uint8_t i = (uint8_t)((head_ + n_) % kWindow);
+    if (n_ == kWindow) head_ = (uint8_t)((head_ + 1) % kWindow);
+    else n_++;
+    t_ms_[i] = t_ms;
+    mg_[i] = mg;
+    if (n_ < kWindow) return;
+    uint8_t mid = (uint8_t)((head_ + TAU_ONSET_SPAN) % kWindow);
+    float dt_s = (t_ms - t_ms_[head_]) / 1000.0f;
+    if (dt_s > 0.0f) flowAt(t_ms_[mid], (float)(mg - mg_[head_]) / dt_s);
+}
+
+void DecayOnsetProbe::flowAt(float t_ms, float v_mgps) {
+    // time between the previous flow point and this one where v passed level
+    auto crossing = [&](float level) {
+        float dv = prev_v_ - v_mgps;
+        float f = dv > 0.0f ? (prev_v_ - level) / dv : 1.0f;
+        return prev_ms_ + fminf(fmaxf(f, 0.0f), 1.0f) * (t_ms - prev_ms_);
+    };
+    float hi = TAU_ONSET_HI * v_ref_, lo = TAU_ONSET_LO * v_ref_;
+    if (prev_v_ >= hi && v_mgps < hi) hi_ms_ = crossing(hi);
+    if (v_mgps < lo) {
+        // no fall through the upper level: the flow was below it at the
+        // stop already, there is no decay to time
+        if (hi_ms_ >= 0.0f) {
+            float lo_ms = crossing(lo);
+            float onset_ms = hi_ms_ - (1.0f - TAU_ONSET_HI) /
+                                          (TAU_ONSET_HI - TAU_ONSET_LO) *
+                                          (lo_ms - hi_ms_);
+            ms_ = fmaxf(onset_ms, 0.0f);
+        }
+        done_ = true;
+        return;
+    }
+    prev_ms_ = t_ms;
+    prev_v_ = v_mgps;
+}
+
+bool DecayOnsetProbe::measureMs(float& ms) const {
+    if (v_ref_ <= 0.0f || ms_ < 0.0f) return false;
+    ms = ms_;
+    return true;
+}
+
+void LatencyEstimate::learn(float measured_ms) {
+    float m = fminf(fmaxf(measured_ms, 0.0f), (float)TAU_COMM_MAX_MS);
+    float r = m - ms;
+    float gain = fmaxf(1.0f / (runs + 2), TAU_MIN_GAIN);
+    if (runs == 0) {
+        // nothing to clip against yet: blend with the default unclipped
+        ms += gain * r;
+        dev_ms = fmaxf(gain * fabsf(r), TAU_DEV_MIN_MS);
+        runs = 1;
+        return;
+    }
+    float lim = TAU_HUBER_K * dev_ms;
+    float rc = fminf(fmaxf(r, -lim), lim);
+    ms += gain * rc;
+    dev_ms += gain * (fminf(fabsf(r), lim) - dev_ms);
+    if (dev_ms < TAU_DEV_MIN_MS) dev_ms = TAU_DEV_MIN_MS;
+    if (runs < 255) runs++;
+}
@@ -0,0 +1,214 @@
+#include "logging.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include <atomic>
+
+#include "ring.h"
+#include "timebase.h"
+
+namespace logging {
+namespace {
+MpscQueue<Record, LOG_QUEUE_LEN> queue;
+std::atomic<uint8_t> levels[(uint8_t)Module::COUNT];
+bool levels_set = false;
+TaskHandle_t task = nullptr;
+uint32_t reported_drops = 0;
+// pause() handshake with the drain task: each sees the other's flag
+std::atomic<bool> paused{false};
+std::atomic<bool> draining{false};
+
+const char* const kModuleNames[(uint8_t)Module::COUNT] = {
+    "main", "ctrl", "scale", "enc", "disp", "nvs", "switch"};
+const char kLevelChars[] = {'E', 'W', 'I', 'D'};
+
+void initLevels() {
+    if (levels_set) return;
+    for (auto& l : levels)
+        l.store(LOG_LEVEL_COMPILED, std::memory_order_relaxed);
+    levels_set = true;
+}
+
+// One conversion of fmt (at '%') with the next argument; returns the
+// characters of fmt it consumed
+size_t formatArg(const char* fmt, const Record& r, uint8_t& next, char* out,
+                 size_t len, size_t& written) {
+    // %[flags][width][.precision][length]conversion, no '*'
+    char spec[16];
+    size_t n = 0;
+    const char* p = fmt + 1;
+    spec[n++] = '%';
+    while (*p && strchr("-+ #0123456789.", *p) && n < sizeof spec - 4)
+        spec[n++] = *p++;
+    while (*p && strchr("hlLqjzt", *p)) p++;  // lengths come from the type
+    char conv = *p ? *p++ : '\0';
+    size_t used = p - fmt;
+    if (conv == '%') {
+        written = snprintf(out, len, "%%");
+        return used;
+    }
+    if (next >= r.nargs || !conv) {
+        written = snprintf(out, len, "<?>");
+        return used;
+    }
+    uint8_t i = next++;
+    uint8_t type = r.type[i];
+    spec[n] = '\0';
+
+    if (conv == 's') {
+        const char* s = type == Record::STR && r.arg[i].u < kTextLen
+                            ? r.text + r.arg[i].u
+                            : "<?>";
+        spec[n++] = 's';
+        spec[n] = '\0';
+        written = snprintf(out, len, spec, s);
+        return used;
+    }
+    if (strchr("feEgGaA", conv)) {
+        double d = type == Record::DOUBLE ? r.arg[i].d
+                   : type == Record::INT  ? (double)r.arg[i].i
+                                          : (double)r.arg[i].u;
+        spec[n++] = conv;
+        spec[n] = '\0';
+        written = snprintf(out, len, spec, d);
+        return used;
+    }
+    if (conv == 'c') {
+        spec[n++] = 'c';
+        spec[n] = '\0';
+        written = snprintf(out, len, spec, (int)r.arg[i].i);
+        return used;
+    }
+    // integers, widened to long long
+    long long v = type == Record::DOUBLE ? (long long)r.arg[i].d
+                                         : (long long)r.arg[i].i;
+    if (conv == 'p') {
+        spec[n++] = '#';
+        conv = 'x';
+    }
+    spec[n++] = 'l';
+    spec[n++] = 'l';
+    spec[n++] = strchr("dioxXu", conv) ? conv : 'd';
+    spec[n] = '\0';
+    if (spec[n - 1] == 'd' || spec[n - 1] == 'i')
+        written = snprintf(out, len, spec, v);
+    else
+        written = snprintf(out, len, spec, (unsigned long long)v);
+    return used;
+}
+
+void drain() {
+    char line[160];
+    while (const Record* r = queue.front()) {
+        size_t n = format(*r, line, sizeof line - 1);
+        line[n++] = '\n';
+        Serial.write((const uint8_t*)line, n);
+        queue.pop();
+    }
+    uint32_t d = queue.dropped();
+    if (d != reported_drops) {
+        int n = snprintf(line, sizeof line, "log: %lu records dropped\n",
+                         (unsigned long)(d - reported_drops));
+        Serial.write((const uint8_t*)line, n);
+        reported_drops = d;
+    }
+}
+
+void taskBody(void*) {
+    for (;;) {
+        draining.store(true);
+        if (!paused.load()) drain();
+        draining.store(false);
+        // resume() wakes the task early to flush what queued while paused
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
+}  // namespace
+
+void begin() {
+    initLevels();
+    if (task) return;
+    if (xTaskCreatePinnedToCore(taskBody, "LogDrain", LOG_TASK_STACK, nullptr,
+                                LOG_TASK_PRIORITY, &task,
+                                LOG_TASK_CORE) != pdPASS)
+        task = nullptr;
+}
+
+void update() {
+    if (!task && !paused.load()) drain();
+}
+
+void pause() {
+    paused.store(true);
+    while (draining.load()) vTaskDelay(1);
+}
+
+void resume() {
+    paused.store(false);
+    if (task)
+        xTaskNotifyGive(task);
+    else
+        drain();
+}
+
+void setLevel(Level l) {
+    initLevels();
+    for (auto& v : levels) v.store((uint8_t)l, std::memory_order_relaxed);
+}
+
+void setLevel(Module m, Level l) {
+    initLevels();
+    levels[(uint8_t)m].store((uint8_t)l, std::memory_order_relaxed);
+}
+
+Level level(Module m) {
+    initLevels();
+    return (Level)levels[(uint8_t)m].load(std::memory_order_relaxed);
+}
+
+bool enabled(Level l, Module m) {
+    // before begin() everything compiled in is on
+    if (!levels_set) return true;
+    return (uint8_t)l <= levels[(uint8_t)m].load(std::memory_order_relaxed);
+}
+
+uint32_t dropped() { return queue.dropped(); }
+
+Record* claim(Level l, Module m, const char* fmt, uint32_t& ticket) {
+    Record* r = queue.claim(ticket);
+    if (!r) return nullptr;
+    r->fmt = fmt;
+    r->t_ms = (uint32_t)(monoUs() / 1000);
+    r->level = l;
+    r->module = m;
+    r->nargs = 0;
+    r->text_used = 0;
+    return r;
+}
+
+void publish(uint32_t ticket) { queue.publish(ticket); }
+
+size_t format(const Record& r, char* out, size_t len) {
+    if (len == 0) return 0;
+    int n = snprintf(out, len, "[%lu.%03lu %c %s] ",
+                     (unsigned long)(r.t_ms / 1000),
+                     (unsigned long)(r.t_ms % 1000),
+                     kLevelChars[(uint8_t)r.level & 3],
+                     kModuleNames[(uint8_t)r.module]);
+    size_t at = n < 0 ? 0 : (size_t)n < len ? (size_t)n : len - 1;
+    uint8_t next = 0;
+    for (const char* f = r.fmt; *f && at + 1 < len;) {
+        if (*f != '%') {
+            out[at++] = *f++;
+            continue;
+        }
+        size_t w = 0;
+        f += formatArg(f, r, next, out + at, len - at, w);
+        at += w < len - at ? w : len - at - 1;
+    }
+    out[at] = '\0';
+    return at;
+}
+
+}  // namespace logging
@@ -15,15 +15,21 @@
 #include "controller.h"
 #include "display.h"
 #include "encoder.h"
+#include "logging.h"
+#include "profiler.h"
 #include "scale.h"
 #include "storage.h"
 #include "switch.h"
+#include "telemetry.h"
+#include "trace.h"
 
 Scale gScale;
 Encoder gEncoder(UI_LONGPRESS_MS);
 Buttons gButtons(UI_LONGPRESS_MS);
 Display gDisplay;
 Controller gController;
+TraceRecorder gTrace;
+TelemetryLog gTelemetry;
 
 #ifdef USE_WIFI
 FritzAHA gFritz(FRITZ_BASE, FRITZ_USER, FRITZ_PASS);
@@ -39,6 +45,8 @@ void setup() {
         ;  // wait for serial port to connect. Needed for native USB ports
     }
     Serial.println("Booting Coffee Scale...");
+    // log records queue from here on; drained on core 0
+    logging::begin();
 
     // NVS init
     storage::begin();
@@ -51,7 +59,8 @@ void setup() {
     gButtons.begin(PIN_BTN_START);
     gEncoder.begin(PIN_ENC_A, PIN_ENC_B, PIN_ENC_SW);
 
-    // Scale init
+    // Scale init; wake loop() whenever the sampling task publishes a sample
+    gScale.notifyOnSample(xTaskGetCurrentTaskHandle());
     gScale.begin(PIN_HX_DT, PIN_HX_SCK);
 
 #ifndef USE_WIFI
@@ -89,15 +98,18 @@ void setup() {
     gScale.setCalMgPerCountQ16(q16);
     int32_t tareRaw = storage::loadTareRaw(0);
     gScale.setTareRaw(tareRaw);
-    int32_t sp = storage::loadSetpointMg(14000);
-    gController.setSetpointMg(sp);
-    float kv = storage::loadKv(0.0f);
-    gController.setKvMgPerGps(kv);
+    ProfileStore& profiles = gController.profiles();
+    storage::loadProfiles(profiles);
+    storage::loadLatency(gRelay.actuator(), gController.latency());
 
+    // From here on the controller publishes views and the task draws them
+    gDisplay.startTask();
     gController.begin(&gScale, &gEncoder, &gButtons, &gDisplay, &gRelay);
+    gController.setTraceRecorder(&gTrace);
+    gController.setTelemetry(&gTelemetry);
 
     Serial.println("Coffee Scale ready.");
-    Serial.println("Using persisted calibration/tare/setpoint if available.");
+    Serial.println("Using persisted calibration/tare/profiles if available.");
     Serial.println("HX711 samples at:");
     Serial.printf("\t%u SPS during measuring.\n", lroundf(1000.0f/HX711_PERIOD_FAST_MS));
     Serial.printf("\t%u SPS during idle time.\n", lroundf(1000.0f/HX711_PERIOD_IDLE_MS));
@@ -109,15 +121,106 @@ void setup() {
     Serial.println(q16);
     Serial.print("  tare_raw: ");
     Serial.println(tareRaw);
-    Serial.print("  setpoint_mg: ");
-    Serial.println(sp);
-    Serial.print("  k_v (mg per g/s): ");
-    Serial.println(kv);
+    const LatencyEstimate& tau = gController.latency();
+    Serial.printf("  tau_comm_ms: %.1f (%u runs)\n", (double)tau.ms,
+                  (unsigned)tau.runs);
+    for (uint8_t i = 0; i < ProfileStore::kCount; ++i) {
+        const Profile& p = profiles.at(i);
+        Serial.printf(
+            "  %cP%u %s: setpoint_mg=%ld bins=%u "
+            "pulse_mg_per_ms=%.3f (%u pulses)\n",
+            i == profiles.activeIndex() ? '*' : ' ', (unsigned)i + 1, p.name,
+            (long)p.setpoint_mg,
+            (unsigned)p.ot.learnedBins(), (double)p.pulse.mg_per_ms,
+            (unsigned)p.pulse.pulses);
+    }
+}
+
+// Sample-to-relay-off latency percentiles of recent automatic stops
+static void printCutoffLatency() {
+    static const char* const kNames[CutoffLatencyLog::kPaths] = {
+        "fast", "loop", "timer"};
+    const CutoffLatencyLog& log = gController.cutoffLatency();
+    for (uint8_t i = 0; i < CutoffLatencyLog::kPaths; ++i) {
+        uint32_t p50, p90, p99, max;
+        uint8_t n;
+        if (!log.percentiles((CutoffLatencyLog::Path)i, p50, p90, p99, max, n))
+            continue;
+        Serial.printf("%-5s p50=%luus p90=%luus p99=%luus max=%luus (%u)\n",
+                      kNames[i], (unsigned long)p50, (unsigned long)p90,
+                      (unsigned long)p99, (unsigned long)max, (unsigned)n);
+    }
+}
+
+// Dumps block loop() for seconds at 115200 baud (about 3.5 s for the
+// telemetry), long enough to overflow the sample ring mid-run; they wait
+// until the controller is idle
+static bool gTraceDumpPending = false;
+static bool gTelemetryDumpPending = false;
+
+static void runPendingDumps() {
+    if (gController.state() != AppState::IDLE) return;
+    if (!gTraceDumpPending && !gTelemetryDumpPending) return;
+    // a log line inside a dump breaks a frame's CRC or a trace line
+    logging::pause();
+    if (gTraceDumpPending) {
+        gTraceDumpPending = false;
+        gTrace.dump(Serial);
+    }
+    if (gTelemetryDumpPending) {
+        gTelemetryDumpPending = false;
+        gTelemetry.dump(Serial);
+    }
+    logging::resume();
+}
+
+// Single-character serial commands
+static void handleSerial() {
+    while (Serial.available()) {
+        switch (Serial.read()) {
+            case 't':  // dump last run trace for host replay
+                gTraceDumpPending = true;
+                break;
+            case 'b':  // binary telemetry of the last runs for decode
+                gTelemetryDumpPending = true;
+                break;
+            case 'l':  // cutoff latency percentiles
+                printCutoffLatency();
+                break;
+#if PROFILER
+            case 'p':  // hot-path profile since the last report
+                prof::report(Serial);
+                break;
+#endif
+            case 'v': {  // cycle the runtime log level of all modules
+                static const char* const kLevels[] = {"error", "warn", "info",
+                                                      "debug"};
+                uint8_t l = ((uint8_t)logging::level(logging::Module::MAIN) +
+                             1) % 4;
+                logging::setLevel((logging::Level)l);
+                Serial.printf("log level %s%s\n", kLevels[l],
+                              l > LOG_LEVEL_COMPILED ? " (not compiled in)"
+                                                     : "");
+                break;
+            }
+            default:
+                break;
+        }
+    }
 }
 
 void loop() {
-    gController.update();
+    {
+        // one iteration's work, without serial commands and the idle wait
+        PROF_SCOPE(LOOP);
+        gController.update();
+        logging::update();  // only without the drain task
+        gDisplay.update();  // only without the display task
+    }
+    handleSerial();
+    runPendingDumps();
 
-    // Tiny idle delay to keep the loop cooperative
-    delay(1);
+    // Cooperative idle: sleep up to 1 ms, but wake as soon as the sampling
+    // task publishes a new sample so the cutoff sees it without delay
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
 }
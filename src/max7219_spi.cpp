@@ -0,0 +1,100 @@
+#include "max7219_spi.h"
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#include "config.h"
+
+bool Max7219Spi::begin(int host, int dinPin, int clkPin, int csPin,
+                       uint8_t bytes) {
+    if (dev_ || bytes == 0 || bytes > kMaxBytes) return false;
+    len_ = bytes;
+    buf_ = (uint8_t*)heap_caps_malloc(kSlots * kMaxBytes, MALLOC_CAP_DMA);
+    if (!buf_) return false;
+    trans_ = new spi_transaction_t[kSlots]();
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = dinPin;
+    bus.miso_io_num = -1;
+    bus.sclk_io_num = clkPin;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = kMaxBytes;
+    spi_host_device_t h = (spi_host_device_t)host;
+    if (spi_bus_initialize(h, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        release();
+        return false;
+    }
+
+    // Mode 0: the MAX7219 samples DIN on the rising edge of CLK and loads
+    // the shifted word into its register when CS goes high
+    spi_device_interface_config_t dev = {};
+    dev.mode = 0;
+    dev.clock_speed_hz = DISPLAY_SPI_HZ;
+    dev.spics_io_num = csPin;
+    dev.queue_size = kSlots;
+    if (spi_bus_add_device(h, &dev, &dev_) != ESP_OK) {
+        dev_ = nullptr;
+        spi_bus_free(h);
+        release();
+        return false;
+    }
+
+    host_ = host;
+    next_ = 0;
+    inflight_ = 0;
+    return true;
+}
+
+void Max7219Spi::end() {
+    if (!dev_) return;
+    spi_transaction_t* done;
+    while (inflight_ &&
+           spi_device_get_trans_result(dev_, &done, portMAX_DELAY) == ESP_OK)
+        inflight_--;
+    spi_bus_remove_device(dev_);
+    dev_ = nullptr;
+    spi_bus_free((spi_host_device_t)host_);
+    host_ = -1;
+    inflight_ = 0;
+    release();
+}
+
+void Max7219Spi::release() {
+    heap_caps_free(buf_);
+    buf_ = nullptr;
+    delete[] trans_;
+    trans_ = nullptr;
+}
+
+bool Max7219Spi::write(const uint8_t* bytes) {
+    if (!dev_) return false;
+
+    // Slots complete in order, so the one after the newest is the oldest.
+    // Collect results only once all are used: one queue call per write less.
+    if (inflight_ == kSlots) {
+        spi_transaction_t* done;
+        while (inflight_ &&
+               spi_device_get_trans_result(dev_, &done, 0) == ESP_OK)
+            inflight_--;
+        if (inflight_ == kSlots) {
+            if (spi_device_get_trans_result(dev_, &done, portMAX_DELAY) !=
+                ESP_OK)
+                return false;
+            inflight_--;
+        }
+    }
+
+    uint8_t* buf = buf_ + next_ * kMaxBytes;
+    memcpy(buf, bytes, len_);
+    spi_transaction_t& t = trans_[next_];
+    t = spi_transaction_t();
+    t.length = len_ * 8;
+    t.tx_buffer = buf;
+    if (spi_device_queue_trans(dev_, &t, 0) != ESP_OK) return false;
+    next_ = (next_ + 1) % kSlots;
+    inflight_++;
+    return true;
+}
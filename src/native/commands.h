@@ -0,0 +1,7 @@
+#pragma once
+// Host program sub-commands (argv without the command name)
+int cmdBench(int argc, char** argv);
+int cmdBenchEst(int argc, char** argv);
+int cmdDecode(int argc, char** argv);
+int cmdReplay(int argc, char** argv);
+int cmdSim(int argc, char** argv);
@@ -0,0 +1,144 @@
+// Telemetry dump ("b" on serial) to CSV: one line per recorded sample
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "commands.h"
+#include "telemetry.h"
+
+namespace {
+
+uint64_t getLe(const uint8_t*& p, int bytes) {
+    uint64_t v = 0;
+    for (int b = 0; b < bytes; ++b) v |= (uint64_t)*p++ << (8 * b);
+    return v;
+}
+
+int32_t get24(const uint8_t* p) {
+    int32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return v & 0x800000 ? v - 0x1000000 : v;  // sign-extend
+}
+
+const char* endName(uint8_t e) {
+    switch (e) {
+        case TelemetryLog::AUTO: return "auto";
+        case TelemetryLog::MANUAL: return "manual";
+        case TelemetryLog::TIMEOUT: return "timeout";
+        default: return "open";
+    }
+}
+
+// One run frame's payload; false if it does not parse
+bool printRun(const uint8_t* p, size_t len, FILE* out) {
+    if (len < TelemetryLog::kRunHeaderSize ||
+        p[0] != TelemetryLog::kVersion)
+        return false;
+    const uint8_t* q = p + 1;
+    unsigned number = getLe(q, 2);
+    unsigned profile = *q++;
+    uint8_t end = *q++;
+    bool overflow = *q++;
+    uint64_t t0_us = getLe(q, 8);
+    int32_t sp = (int32_t)getLe(q, 4);
+    int32_t cal = (int32_t)getLe(q, 4);
+    int32_t tare = (int32_t)getLe(q, 4);
+    float tau_ms = getLe(q, 2) / 10.0f;
+    int32_t final_mg = (int32_t)getLe(q, 4);
+    uint32_t cutoff_dt_us = getLe(q, 4);
+    size_t n = getLe(q, 2);
+    if (len !=
+        TelemetryLog::kRunHeaderSize + n * sizeof(TelemetryLog::Record))
+        return false;
+
+    fprintf(out,
+            "# run %u profile=P%u setpoint_mg=%ld final_mg=%ld end=%s "
+            "cutoff_us=%llu cal_q16=%ld tare_raw=%ld tau_comm_ms=%.1f "
+            "samples=%zu%s\n",
+            number, profile + 1, (long)sp, (long)final_mg, endName(end),
+            cutoff_dt_us ? (unsigned long long)(t0_us + cutoff_dt_us) : 0ull,
+            (long)cal, (long)tare, (double)tau_ms, n,
+            overflow ? " overflow" : "");
+    uint64_t t = t0_us;
+    for (size_t i = 0; i < n; ++i, q += sizeof(TelemetryLog::Record)) {
+        TelemetryLog::Record r;
+        memcpy(&r, q, sizeof r);
+        t += r.dt_us;
+        int32_t lead = r.lead_mg;
+        fprintf(out, "%u,%llu,%u,%ld,%ld,%d,%.0f,%ld,%d,%d,%d,%d,%d,%d\n",
+                number, (unsigned long long)t, (unsigned)r.lost,
+                (long)get24(r.counts), (long)get24(r.x_mg), r.v_mgps,
+                r.a_q * TelemetryLog::kAccelUnit, (long)(sp - lead),
+                !!(r.flags & TelemetryLog::RELAY),
+                !!(r.flags & TelemetryLog::APPROACH),
+                !!(r.flags & TelemetryLog::STOP),
+                !!(r.flags & TelemetryLog::FAST),
+                !!(r.flags & TelemetryLog::TIMER),
+                !!(r.flags & TelemetryLog::LSQ));
+    }
+    return true;
+}
+
+}  // namespace
+
+int cmdDecode(int argc, char** argv) {
+    if (argc < 1) {
+        fprintf(stderr, "usage: program decode dump [out.csv]\n");
+        return 2;
+    }
+    FILE* in = fopen(argv[0], "rb");
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", argv[0]);
+        return 1;
+    }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof chunk, in)) > 0)
+        buf.insert(buf.end(), chunk, chunk + got);
+    fclose(in);
+    FILE* out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out,
+            "run,t_us,lost,counts,x_mg,v_mgps,a_mgps2,threshold_mg,relay,"
+            "approach,stop,fast,timer,lsq\n");
+    // scan for frames: text around the dump (serial log) and frames with a
+    // bad CRC are skipped
+    int runs = 0, bad = 0;
+    bool ended = false;
+    for (size_t i = 0; i + 7 <= buf.size() && !ended;) {
+        if (buf[i] != TelemetryLog::kSync0 ||
+            buf[i + 1] != TelemetryLog::kSync1) {
+            ++i;
+            continue;
+        }
+        const uint8_t* f = &buf[i + 2];
+        size_t len = f[1] | (f[2] << 8);
+        if (i + 2 + 3 + len + 2 > buf.size()) {
+            ++i;
+            continue;
+        }
+        uint16_t crc = TelemetryLog::crc16(0xFFFF, f, 3 + len);
+        uint16_t got_crc = f[3 + len] | (f[4 + len] << 8);
+        if (crc != got_crc) {
+            ++i;
+            continue;
+        }
+        if (f[0] == TelemetryLog::FRAME_RUN) {
+            if (printRun(f + 3, len, out)) runs++;
+            else bad++;
+        } else if (f[0] == TelemetryLog::FRAME_END) {
+            ended = true;
+        }
+        i += 2 + 3 + len + 2;
+    }
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "%d runs%s", runs, ended ? "" : ", no end frame");
+    if (bad) fprintf(stderr, ", %d unreadable", bad);
+    fprintf(stderr, "\n");
+    return runs || ended ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "grinder_sim.h"
+
+#include <math.h>
+
+GrinderSim::Params GrinderSim::relayParams() { return Params(); }
+
+GrinderSim::Params GrinderSim::plugParams() {
+    Params p;
+    // HTTP round trip to the FRITZ!Box and the plug's own switching delay
+    p.on_latency_ms = 250.0f;
+    p.off_latency_ms = 300.0f;
+    p.latency_jitter_ms = 80.0f;
+    return p;
+}
+
+GrinderSim::GrinderSim(const Params& p)
+    : p_(p),
+      rng_(p.seed),
+      period_us_(1000000u / (p.sps ? p.sps : 80)),
+      flight_((size_t)fmaxf(1.0f, p.fall_ms), 0.0f) {
+    sim_us_ = hal::nowUs();
+    hal::onOutputChange(&GrinderSim::onPin, this);
+}
+
+GrinderSim::~GrinderSim() { hal::onOutputChange(nullptr, nullptr); }
+
+void GrinderSim::onPin(uint8_t pin, int level, uint64_t t_us, void* ctx) {
+    if (pin != PIN_RELAY) return;
+    GrinderSim* s = static_cast<GrinderSim*>(ctx);
+    bool on = level == HIGH;
+    float lat = on ? s->p_.on_latency_ms : s->p_.off_latency_ms;
+    lat += (2.0f * s->unif_(s->rng_) - 1.0f) * s->p_.latency_jitter_ms;
+    uint64_t t = t_us + (uint64_t)(fmaxf(0.0f, lat) * 1000.0f);
+    // commands are executed in order: jitter cannot swap a short pulse
+    if (!s->edges_.empty() && t < s->edges_.back().t_us)
+        t = s->edges_.back().t_us;
+    s->edges_.push_back({t, on});
+}
+
+bool GrinderSim::nextAt(uint64_t& t_us) {
+    if (next_us_ == 0) next_us_ = hal::nowUs() + period_us_;
+    t_us = next_us_;
+    return true;
+}
+
+int32_t GrinderSim::take() {
+    advanceTo(next_us_);
+    next_us_ += period_us_;
+    float mg = cup_mg_ + creep_mg_ + gauss_(rng_) * p_.noise_mg;
+    float counts = mg * 65536.0f / (float)CAL_MG_PER_COUNT_Q16;
+    return (int32_t)lroundf(counts) + SCALE_OFFSET_COUNTS;
+}
+
+void GrinderSim::empty() {
+    cup_mg_ = 0.0f;
+    creep_mg_ = 0.0f;
+}
+
+void GrinderSim::advanceTo(uint64_t t_us) {
+    while (sim_us_ + 1000 <= t_us) {
+        sim_us_ += 1000;
+        step1ms();
+    }
+}
+
+void GrinderSim::step1ms() {
+    const float dt = 1.0f;  // ms
+
+    // actuator: apply commanded edges once their latency has elapsed
+    for (size_t i = 0; i < edges_.size();) {
+        if (edges_[i].t_us <= sim_us_) {
+            powered_ = edges_[i].on;
+            edges_.erase(edges_.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+
+    // motor: first-order spin-up / coast-down
+    if (powered_)
+        speed_ += (1.0f - speed_) * dt / p_.ramp_ms;
+    else
+        speed_ -= speed_ * dt / p_.spin_down_ms;
+
+    // bursty flow: Ornstein-Uhlenbeck deviation around the nominal rate
+    float k = dt / p_.burst_ms;
+    burst_ += -burst_ * k + p_.burst_sd * sqrtf(2.0f * k) * gauss_(rng_);
+    float out = p_.flow_gps * speed_ * fmaxf(0.0f, 1.0f + burst_) * dt;  // mg
+
+    // part of it sticks in the chute and drops as clumps
+    chute_mg_ += out * p_.clump_frac;
+    float falling = out * (1.0f - p_.clump_frac);
+    if (unif_(rng_) < p_.clump_hz * speed_ * dt / 1000.0f) {
+        falling += chute_mg_;
+        chute_mg_ = 0.0f;
+    }
+
+    // fall delay, then the cup and a slow creep of the load cell
+    cup_mg_ += flight_[flight_i_];
+    flight_[flight_i_] = falling;
+    flight_i_ = (flight_i_ + 1) % flight_.size();
+    creep_mg_ += (p_.creep_frac * cup_mg_ - creep_mg_) * dt / p_.creep_ms;
+}
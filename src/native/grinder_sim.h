@@ -0,0 +1,80 @@
+#pragma once
+// Physics model of grinder + cup + load cell for closed-loop host runs.
+//
+// The relay pin is watched through hal::onOutputChange; the motor reacts
+// after an actuator latency (GPIO relay or network plug), spins up and
+// coasts down with first-order dynamics, and the burr output reaches the
+// cup after a fall delay. Flow is modulated by correlated bursts and part
+// of it is retained in the chute and released in clumps. The load cell adds
+// creep and white noise and is read out as HX711 counts at 10 or 80 SPS.
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include "config.h"
+#include "hal_native.h"
+
+class GrinderSim : public hal::LoadCellSource {
+   public:
+    struct Params {
+        uint32_t sps = 80;            // HX711 RATE pin: 10 or 80
+        float flow_gps = 2.0f;        // steady-state flow at full speed
+        float ramp_ms = 250.0f;       // motor spin-up time constant
+        float spin_down_ms = 120.0f;  // coast-down time constant
+        float fall_ms = 60.0f;        // burr exit -> cup
+        float burst_sd = 0.15f;       // relative flow fluctuation
+        float burst_ms = 150.0f;      // its correlation time
+        float clump_frac = 0.10f;     // share of flow retained in the chute
+        float clump_hz = 3.0f;        // chute release rate at full speed
+        float on_latency_ms = 8.0f;   // relay command -> motor power
+        float off_latency_ms = 10.0f;
+        float latency_jitter_ms = 2.0f;  // uniform +-
+        float noise_mg = 15.0f;       // load cell white noise (1 sigma)
+        float creep_frac = 0.002f;    // final creep relative to load
+        float creep_ms = 30000.0f;    // creep time constant
+        uint32_t seed = 1;
+    };
+    // Actuator presets: local relay vs FRITZ!Box AHA plug over WiFi
+    static Params relayParams();
+    static Params plugParams();
+
+    explicit GrinderSim(const Params& p);
+    ~GrinderSim() override;
+
+    bool nextAt(uint64_t& t_us) override;
+    int32_t take() override;
+
+    void empty();  // take the cup away (chute retention stays)
+    float cupMg() const { return cup_mg_; }
+    const Params& params() const { return p_; }
+    void setFlowGps(float gps) { p_.flow_gps = gps; }
+
+   private:
+    static void onPin(uint8_t pin, int level, uint64_t t_us, void* ctx);
+    void advanceTo(uint64_t t_us);
+    void step1ms();
+
+    struct Edge {
+        uint64_t t_us;
+        bool on;
+    };
+
+    Params p_;
+    std::mt19937 rng_;
+    std::normal_distribution<float> gauss_{0.0f, 1.0f};
+    std::uniform_real_distribution<float> unif_{0.0f, 1.0f};
+
+    uint64_t period_us_;
+    uint64_t next_us_ = 0;
+    uint64_t sim_us_ = 0;  // model integrated up to here
+    std::vector<Edge> edges_;  // commanded, not yet effective
+    bool powered_ = false;
+    float speed_ = 0.0f;   // 0..1 of full burr speed
+    float burst_ = 0.0f;   // relative flow deviation
+    float chute_mg_ = 0.0f;
+    std::vector<float> flight_;  // per-ms bins falling towards the cup
+    size_t flight_i_ = 0;
+    float cup_mg_ = 0.0f;
+    float creep_mg_ = 0.0f;
+};
@@ -0,0 +1,323 @@
+// Host backend for the firmware's hardware API (see include/native/).
+#include "hal_native.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// esp_timer one-shot; fire_us == 0 while stopped
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void* arg;
+    uint64_t fire_us;
+};
+
+namespace {
+
+constexpr int kPins = 64;
+
+uint64_t g_now_us = 0;
+
+int g_in[kPins];        // input levels driven by the harness
+int g_out[kPins];       // last written output levels
+bool g_in_set[kPins];   // false => reads HIGH (pull-up)
+hal::PinListener g_listener = nullptr;
+void* g_listener_ctx = nullptr;
+
+void (*g_isr[kPins])() = {nullptr};
+int g_isr_mode[kPins] = {0};
+
+hal::LoadCellSource* g_cell = nullptr;
+int g_cell_pin = -1;
+bool g_cell_edge_fired = false;  // DRDY raised for the pending conversion
+
+std::vector<esp_timer*> g_timers;  // created by esp_timer_create
+
+hal::DisplaySink* g_disp = nullptr;
+int g_disp_cs = -1;
+std::vector<uint8_t> g_disp_frame;
+
+bool g_echo = true;
+FILE* g_serial_out = nullptr;  // nullptr => stdout
+
+FILE* serialOut() { return g_serial_out ? g_serial_out : stdout; }
+
+std::map<std::string, std::vector<uint8_t>>& kv() {
+    static std::map<std::string, std::vector<uint8_t>> m;
+    return m;
+}
+
+// Conversion waiting at the load cell (DOUT low)?
+bool cellReady() {
+    uint64_t t;
+    return g_cell && g_cell->nextAt(t) && t <= g_now_us;
+}
+
+// Earliest running timer due at or before t_us
+esp_timer* dueTimer(uint64_t t_us) {
+    esp_timer* due = nullptr;
+    for (esp_timer* t : g_timers)
+        if (t->fire_us && t->fire_us <= t_us &&
+            (!due || t->fire_us < due->fire_us))
+            due = t;
+    return due;
+}
+
+// Deliver MAX7219 register writes of one CS window; the first byte shifted
+// out belongs to the last device in the chain
+void flushDisplayFrame() {
+    size_t n = g_disp_frame.size() / 2;
+    for (size_t d = 0; d < n && g_disp; ++d) {
+        uint8_t op = g_disp_frame[g_disp_frame.size() - 2 - 2 * d];
+        uint8_t val = g_disp_frame[g_disp_frame.size() - 1 - 2 * d];
+        if (op != 0) g_disp->write((uint8_t)d, op, val);  // 0 = no-op
+    }
+    g_disp_frame.clear();
+}
+
+}  // namespace
+
+namespace hal {
+
+uint64_t nowUs() { return g_now_us; }
+
+void advanceToUs(uint64_t t_us) {
+    // Step through DRDY edges and timer expiries in time order so the ISR
+    // stamps exact times and timers see the clock they were armed for
+    for (;;) {
+        uint64_t t = UINT64_MAX;
+        bool drdy = g_cell && !g_cell_edge_fired && g_cell->nextAt(t) &&
+                    t <= t_us;
+        esp_timer* timer = dueTimer(drdy ? t : t_us);
+        if (timer) {
+            if (timer->fire_us > g_now_us) g_now_us = timer->fire_us;
+            timer->fire_us = 0;
+            timer->cb(timer->arg);
+            continue;
+        }
+        if (!drdy) break;
+        if (t > g_now_us) g_now_us = t;
+        g_cell_edge_fired = true;
+        if (g_cell_pin >= 0 && g_isr[g_cell_pin] &&
+            g_isr_mode[g_cell_pin] != RISING)
+            g_isr[g_cell_pin]();
+    }
+    if (t_us > g_now_us) g_now_us = t_us;
+}
+
+void setInput(uint8_t pin, int level) {
+    if (pin >= kPins) return;
+    g_in[pin] = level;
+    g_in_set[pin] = true;
+}
+
+int output(uint8_t pin) { return pin < kPins ? g_out[pin] : LOW; }
+
+void onOutputChange(PinListener fn, void* ctx) {
+    g_listener = fn;
+    g_listener_ctx = ctx;
+}
+
+void attachLoadCell(LoadCellSource* src, uint8_t dtPin) {
+    g_cell = src;
+    g_cell_pin = dtPin;
+    g_cell_edge_fired = false;
+}
+
+LoadCellSource* loadCell() { return g_cell; }
+
+void attachDisplay(DisplaySink* sink, uint8_t csPin) {
+    g_disp = sink;
+    g_disp_cs = csPin;
+    g_disp_frame.clear();
+}
+
+void setSerialEcho(bool on) { g_echo = on; }
+
+void setSerialFile(FILE* f) { g_serial_out = f; }
+
+void kvClear() { kv().clear(); }
+
+void loadCellConsumed() { g_cell_edge_fired = false; }
+
+}  // namespace hal
+
+// ---- Arduino API ----
+HardwareSerial Serial;
+
+int64_t esp_timer_get_time() { return (int64_t)g_now_us; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
+                           esp_timer_handle_t* out) {
+    if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+    esp_timer* t = new esp_timer();
+    t->cb = args->callback;
+    t->arg = args->arg;
+    t->fire_us = 0;
+    g_timers.push_back(t);
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us) {
+    if (!t) return ESP_ERR_INVALID_ARG;
+    if (t->fire_us) return ESP_ERR_INVALID_STATE;  // already running
+    t->fire_us = g_now_us + (timeout_us ? timeout_us : 1);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    if (!t) return ESP_ERR_INVALID_ARG;
+    if (!t->fire_us) return ESP_ERR_INVALID_STATE;  // not running
+    t->fire_us = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+    if (!t) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < g_timers.size(); ++i)
+        if (g_timers[i] == t) {
+            g_timers.erase(g_timers.begin() + i);
+            break;
+        }
+    delete t;
+    return ESP_OK;
+}
+uint32_t millis() { return (uint32_t)(g_now_us / 1000u); }
+uint32_t micros() { return (uint32_t)g_now_us; }
+void delay(uint32_t ms) { hal::advanceUs((uint64_t)ms * 1000u); }
+void delayMicroseconds(uint32_t us) { hal::advanceUs(us); }
+
+void pinMode(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t pin) {
+    if ((int)pin == g_cell_pin) return cellReady() ? LOW : HIGH;
+    if (pin >= kPins || !g_in_set[pin]) return HIGH;
+    return g_in[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= kPins) return;
+    int level = val ? HIGH : LOW;
+    bool changed = g_out[pin] != level;
+    g_out[pin] = level;
+    if ((int)pin == g_disp_cs && level == HIGH && changed) flushDisplayFrame();
+    if (changed && g_listener) g_listener(pin, level, g_now_us, g_listener_ctx);
+}
+
+void shiftOut(uint8_t, uint8_t, uint8_t bitOrder, uint8_t val) {
+    if (g_disp_cs < 0 || g_out[g_disp_cs] != LOW) return;
+    if (bitOrder == LSBFIRST) {
+        uint8_t r = 0;
+        for (int i = 0; i < 8; ++i) r |= ((val >> i) & 1) << (7 - i);
+        val = r;
+    }
+    g_disp_frame.push_back(val);
+}
+
+void attachInterrupt(int pin, void (*isr)(), int mode) {
+    if (pin < 0 || pin >= kPins) return;
+    g_isr[pin] = isr;
+    g_isr_mode[pin] = mode;
+}
+
+void detachInterrupt(int pin) {
+    if (pin >= 0 && pin < kPins) g_isr[pin] = nullptr;
+}
+
+int HardwareSerial::printf(const char* fmt, ...) {
+    if (!g_echo) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(serialOut(), fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+size_t HardwareSerial::print(const char* s) {
+    return g_echo ? fputs(s, serialOut()), strlen(s) : 0;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+    if (g_echo) fputc(b, serialOut());
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+    if (g_echo) fwrite(buf, 1, n, serialOut());
+    return n;
+}
+
+// ---- Preferences (in memory) ----
+namespace {
+std::string fullKey(const char* ns, const char* key) {
+    return std::string(ns) + "/" + key;
+}
+template <typename T>
+T getValue(const char* ns, const char* key, T def) {
+    auto it = kv().find(fullKey(ns, key));
+    if (it == kv().end() || it->second.size() != sizeof(T)) return def;
+    T v;
+    memcpy(&v, it->second.data(), sizeof(T));
+    return v;
+}
+template <typename T>
+size_t putValue(const char* ns, const char* key, T v) {
+    auto& buf = kv()[fullKey(ns, key)];
+    buf.resize(sizeof(T));
+    memcpy(buf.data(), &v, sizeof(T));
+    return sizeof(T);
+}
+}  // namespace
+
+bool Preferences::begin(const char* name, bool) {
+    strncpy(ns_, name, sizeof(ns_) - 1);
+    return true;
+}
+bool Preferences::isKey(const char* key) {
+    return kv().count(fullKey(ns_, key)) != 0;
+}
+bool Preferences::remove(const char* key) {
+    return kv().erase(fullKey(ns_, key)) != 0;
+}
+bool Preferences::clear() {
+    std::string prefix = std::string(ns_) + "/";
+    for (auto it = kv().begin(); it != kv().end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0)
+            it = kv().erase(it);
+        else
+            ++it;
+    }
+    return true;
+}
+int32_t Preferences::getInt(const char* key, int32_t def) {
+    return getValue(ns_, key, def);
+}
+size_t Preferences::putInt(const char* key, int32_t v) {
+    return putValue(ns_, key, v);
+}
+float Preferences::getFloat(const char* key, float def) {
+    return getValue(ns_, key, def);
+}
+size_t Preferences::putFloat(const char* key, float v) {
+    return putValue(ns_, key, v);
+}
+size_t Preferences::getBytesLength(const char* key) {
+    auto it = kv().find(fullKey(ns_, key));
+    return it == kv().end() ? 0 : it->second.size();
+}
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    auto it = kv().find(fullKey(ns_, key));
+    if (it == kv().end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+size_t Preferences::putBytes(const char* key, const void* buf, size_t len) {
+    auto& v = kv()[fullKey(ns_, key)];
+    v.assign((const uint8_t*)buf, (const uint8_t*)buf + len);
+    return len;
+}
@@ -0,0 +1,38 @@
+// Host backend of the HX711 driver: conversions come from the LoadCellSource
+// attached with hal::attachLoadCell() instead of the SPI peripheral.
+#include <Arduino.h>
+
+#include "hal_native.h"
+#include "hx711_driver.h"
+
+bool Hx711::begin(uint8_t dtPin, uint8_t sckPin, Gain gain) {
+    dt_pin_ = dtPin;
+    sck_pin_ = sckPin;
+    gain_ = gain;
+    busy_ = false;
+    return true;
+}
+
+bool Hx711::isReady() const { return digitalRead(dt_pin_) == LOW; }
+
+bool Hx711::startRead() {
+    if (busy_ || !isReady()) return false;
+    busy_ = true;
+    return true;
+}
+
+bool Hx711::completeRead(int32_t& out, uint32_t) {
+    if (!busy_) return false;
+    busy_ = false;
+    out = hal::loadCell()->take();
+    hal::loadCellConsumed();
+    return true;
+}
+
+bool Hx711::read(int32_t& out) {
+    uint64_t t;
+    hal::LoadCellSource* src = hal::loadCell();
+    if (!src || !src->nextAt(t)) return false;
+    if (t > hal::nowUs()) hal::advanceToUs(t);
+    return startRead() && completeRead(out);
+}
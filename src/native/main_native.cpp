@@ -0,0 +1,164 @@
+// Host entry point (pio run -e native && .pio/build/native/program <cmd>).
+// Runs the firmware's Scale/Controller hot paths on the virtual hardware.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "../bench/est_bench.h"
+#include "commands.h"
+#include "profiler.h"
+#include "rig.h"
+#include "storage.h"
+#include "utils.h"
+
+namespace {
+
+// Synthetic load cell: constant flow while the relay is on, plus noise
+class FlowCell : public hal::LoadCellSource {
+   public:
+    FlowCell(uint32_t periodUs, float flowGps)
+        : period_us_(periodUs), flow_mgps_(flowGps * 1000.0f) {}
+
+    bool nextAt(uint64_t& t_us) override {
+        if (next_us_ == 0) next_us_ = hal::nowUs() + period_us_;
+        t_us = next_us_;
+        return true;
+    }
+
+    int32_t take() override {
+        uint64_t t = next_us_;
+        float dt = (t - last_us_) * 1e-6f;
+        last_us_ = t;
+        next_us_ = t + period_us_;
+        if (hal::output(PIN_RELAY) == HIGH) mass_mg_ += flow_mgps_ * dt;
+        seed_ = seed_ * 1664525u + 1013904223u;  // LCG noise, +-15 mg
+        float noise = ((int32_t)(seed_ >> 16) % 31 - 15);
+        float counts =
+            (mass_mg_ + noise) * 65536.0f / (float)CAL_MG_PER_COUNT_Q16;
+        return (int32_t)lroundf(counts) + SCALE_OFFSET_COUNTS;
+    }
+
+    float massMg() const { return mass_mg_; }
+    void empty() { mass_mg_ = 0.0f; }
+
+   private:
+    uint32_t period_us_;
+    float flow_mgps_;
+    float mass_mg_ = 0.0f;
+    uint64_t next_us_ = 0, last_us_ = 0;
+    uint32_t seed_ = 12345;
+};
+
+using Clock = std::chrono::steady_clock;
+
+}  // namespace
+
+// Hot-path throughput: full grind cycles through Scale + Controller
+int cmdBench(int argc, char** argv) {
+    int runs = argc > 0 ? atoi(argv[0]) : 200;
+    hal::setSerialEcho(false);
+    hal::kvClear();
+
+    FlowCell cell(1000000 / 80, 2.0f);
+    Rig rig;
+    rig.begin(&cell);
+    rig.controller.setSetpointMg(18000);
+    // recorded as on the unit, so its cost shows up here
+    static TelemetryLog telem;
+    rig.controller.setTelemetry(&telem);
+
+    uint32_t samples0 = rig.scale.latest().seq;
+    uint32_t loops0 = rig.loops;
+    auto t0 = Clock::now();
+    for (int i = 0; i < runs; ++i) {
+        rig.pressStart();
+        while (rig.controller.state() == AppState::MEASURING) rig.step();
+        rig.runForMs(DONE_HOLD_MS + 500);
+        cell.empty();  // next dose into an empty cup
+        rig.runForMs(1000);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                    .count();
+    uint32_t samples = rig.scale.latest().seq - samples0;
+    uint32_t loops = rig.loops - loops0;
+
+    printf("runs=%d samples=%u loops=%u\n", runs, samples, loops);
+    printf("wall %.1f ms, %.1f ns/loop, %.1f ns/sample (incl. loop passes)\n",
+           ns / 1e6, ns / loops, ns / samples);
+#if PROFILER
+    fflush(stdout);
+    hal::setSerialEcho(true);
+    prof::report(Serial);
+    hal::setSerialEcho(false);
+#endif
+    return 0;
+}
+
+// Estimator update cost (best of reps passes); cycles from the TSC where
+// available, else ns
+int cmdBenchEst(int argc, char** argv) {
+    int reps = argc > 0 ? atoi(argv[0]) : 2000;
+    if (reps < 1) reps = 1;
+#if defined(__x86_64__) || defined(__i386__)
+    auto now = []() { return (uint32_t)__builtin_ia32_rdtsc(); };
+    const char* unit = "TSC cycles";
+#else
+    auto now = []() {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   Clock::now().time_since_epoch())
+            .count();
+    };
+    const char* unit = "ns";
+#endif
+    estbench::Input in;
+    estbench::AlphaBetaDiv ab_div;
+    AlphaBetaEstimator ab;
+    KalmanCaFull kf_full;
+    KalmanCaEstimator kf;
+    kf_full.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+    kf.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+
+    printf("estimator update, %s per sample (80 SPS input)\n", unit);
+    printf("%-36s %u\n", "alpha-beta, per-sample divisions",
+           estbench::cyclesPerUpdate(ab_div, in, now, reps));
+    printf("%-36s %u\n", "alpha-beta, gain table",
+           estbench::cyclesPerUpdate(ab, in, now, reps));
+    printf("%-36s %u\n", "Kalman CA, full covariance",
+           estbench::cyclesPerUpdate(kf_full, in, now, reps));
+    printf("%-36s %u\n", "Kalman CA, steady-state gain table",
+           estbench::cyclesPerUpdate(kf, in, now, reps));
+    uint32_t t0 = now();
+    float K[3];
+    KalmanCaFull::steadyGain({KF_Q_JERK_FAST, KF_R_FAST_MG2}, 0.0125f, K);
+    printf("%-36s %u\n", "Kalman gain solve (table miss)", now() - t0);
+    return 0;
+}
+
+// pio test links src/ into each test, which brings its own main()
+#ifndef PIO_UNIT_TESTING
+static void usage() {
+    fprintf(stderr,
+            "usage: program <command> [args]\n"
+            "  bench [runs]          time Scale+Controller over synthetic grinds\n"
+            "  bench-est [reps]      cycles per estimator update (tables vs. divisions)\n"
+            "  decode dump [csv]     telemetry dump (serial 'b') to CSV\n"
+            "  replay [opts] file..  replay recorded traces, report cutoff/dose\n"
+            "  sim [opts]            closed-loop setpoint sweep on the grinder model\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    if (!strcmp(argv[1], "bench")) return cmdBench(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "bench-est")) return cmdBenchEst(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "decode")) return cmdDecode(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "replay")) return cmdReplay(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "sim")) return cmdSim(argc - 2, argv + 2);
+    usage();
+    return 2;
+}
+#endif
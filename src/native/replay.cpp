@@ -0,0 +1,314 @@
+#include "replay.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "commands.h"
+#include "rig.h"
+#include "storage.h"
+#include "utils.h"
+
+namespace {
+
+// Plays the recorded conversions back at their original spacing
+class TraceCell : public hal::LoadCellSource {
+   public:
+    explicit TraceCell(const Trace& t) : t_(t) { skip(); }
+    void start(uint64_t base_us) {
+        base_us_ = base_us;
+        started_ = true;
+    }
+    bool nextAt(uint64_t& t_us) override {
+        if (!started_ || i_ >= t_.ev.size()) return false;
+        t_us = base_us_ + t_.ev[i_].dt_us;
+        return true;
+    }
+    int32_t take() override {
+        int32_t v = t_.ev[i_++].value;
+        skip();
+        return v;
+    }
+
+   private:
+    void skip() {
+        while (i_ < t_.ev.size() && t_.ev[i_].kind != TraceRecorder::SAMPLE)
+            i_++;
+    }
+    const Trace& t_;
+    size_t i_ = 0;
+    uint64_t base_us_ = 0;
+    bool started_ = false;
+};
+
+// Recorded mass (mg) at trace time dt_us, linear between samples
+double massAt(const Trace& t, double dt_us) {
+    double prev_t = -1, prev_m = 0;
+    for (const auto& e : t.ev) {
+        if (e.kind != TraceRecorder::SAMPLE) continue;
+        int64_t counts = (int64_t)e.value - t.offset_counts - t.h.tare_raw;
+        double m = (double)((counts * t.h.cal_q16) >> 16) + SCALE_OFFSET_MG;
+        if (e.dt_us >= dt_us) {
+            if (prev_t < 0) return m;
+            double f = (dt_us - prev_t) / (e.dt_us - prev_t);
+            return prev_m + f * (m - prev_m);
+        }
+        prev_t = e.dt_us;
+        prev_m = m;
+    }
+    return prev_m;
+}
+
+// Start and cutoff of a run: the first on edge and the last off edge (the
+// slow approach pulses the relay in between)
+bool relayEdges(const Trace& t, double& on_us, double& off_us) {
+    on_us = off_us = -1;
+    for (const auto& e : t.ev) {
+        if (e.kind != TraceRecorder::RELAY) continue;
+        if (e.value && on_us < 0) on_us = e.dt_us;
+        if (!e.value && on_us >= 0) off_us = e.dt_us;
+    }
+    return on_us >= 0 && off_us >= 0;
+}
+
+}  // namespace
+
+bool loadTraces(const char* path, std::vector<Trace>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    Trace cur;
+    bool in = false;
+    int idx = 0;
+    while (fgets(line, sizeof line, f)) {
+        if (!strncmp(line, "#trace", 6)) {
+            cur = Trace();
+            cur.name = std::string(path) + "#" + std::to_string(idx++);
+            long cal = 0, tare = 0, sp = 0, off = SCALE_OFFSET_COUNTS;
+            const char* p;
+            if ((p = strstr(line, "cal_q16="))) cal = atol(p + 8);
+            if ((p = strstr(line, "tare_raw="))) tare = atol(p + 9);
+            if ((p = strstr(line, "setpoint_mg="))) sp = atol(p + 12);
+            if ((p = strstr(line, "offset_counts="))) off = atol(p + 14);
+            // v1/v2 traces predate per-profile latencies
+            cur.h.tau_comm_ms = TAU_COMM_MS;
+            if ((p = strstr(line, "tau_comm_ms=")))
+                cur.h.tau_comm_ms = atof(p + 12);
+            cur.h.cal_q16 = cal;
+            cur.h.tare_raw = tare;
+            cur.h.setpoint_mg = sp;
+            if ((p = strstr(line, "ot="))) {
+                p += 3;
+                for (size_t i = 0; i < sizeof cur.h.ot; ++i, p += 2) {
+                    unsigned b = 0;
+                    if (sscanf(p, "%2x", &b) != 1) break;
+                    cur.h.ot[i] = (uint8_t)b;
+                }
+            } else if ((p = strstr(line, "kv="))) {
+                // v1 traces carry the single k_v the table replaced
+                OvershootTable ot;
+                ot.seedFromKv(atof(p + 3));
+                ot.serialize(cur.h.ot);
+            }
+            cur.offset_counts = off;
+            in = true;
+        } else if (!strncmp(line, "#end", 4)) {
+            if (in) out.push_back(cur);
+            in = false;
+        } else if (in && (line[0] == 'S' || line[0] == 'R') &&
+                   line[1] == ',') {
+            TraceRecorder::Event e;
+            char* q = line + 2;
+            e.dt_us = strtoul(q, &q, 10);
+            e.value = (int32_t)strtol(q + 1, nullptr, 10);
+            e.kind = line[0] == 'S' ? TraceRecorder::SAMPLE
+                                    : TraceRecorder::RELAY;
+            cur.ev.push_back(e);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+ReplayResult replayTrace(const Trace& t, const ReplayOptions& o) {
+    ReplayResult r;
+    double rec_on, rec_off;
+    if (t.ev.empty() || !relayEdges(t, rec_on, rec_off)) return r;
+    r.valid = true;
+
+    // fresh NVS with the parameters the unit had when recording
+    hal::kvClear();
+    storage::begin();
+    storage::saveCalQ16(t.h.cal_q16);
+    storage::saveTareRaw(t.h.tare_raw);
+    ProfileStore profiles;
+    Profile& p = profiles.active();
+    p.setpoint_mg = t.h.setpoint_mg;
+    if (o.kv_override || !p.ot.deserialize(t.h.ot, sizeof t.h.ot))
+        p.ot.seedFromKv(o.kv);
+    storage::saveProfiles(profiles);
+    LatencyEstimate tau;
+    tau.ms = o.tau_comm_ms >= 0 ? o.tau_comm_ms : t.h.tau_comm_ms;
+    storage::saveLatency(Actuator::RELAY, tau);
+
+    TraceCell cell(t);
+    Rig rig;
+    rig.begin(&cell);
+    rig.controller.setTuning(o.tuning);
+#if SCALE_ESTIMATOR_KALMAN
+    rig.scale.setKalmanNoise(o.kf_fast, {KF_Q_JERK_IDLE, KF_R_IDLE_MG2});
+#else
+    rig.scale.setAlphaBeta(o.g, o.h);
+#endif
+
+    uint64_t base = hal::nowUs() + 1000;
+    cell.start(base);
+
+    // press so the start lands on the recorded relay-on edge: the short
+    // press fires one debounce interval after release
+    const uint32_t hold_ms = 80;
+    uint64_t lead = msToUs(hold_ms + DEBOUNCE_MS + 1);
+    uint64_t press_at = base + (uint64_t)rec_on;
+    press_at = press_at > base + lead ? press_at - lead : base;
+    rig.runUntilUs(press_at);
+    rig.pressStart(hold_ms);
+
+    uint64_t end = base + t.ev.back().dt_us;
+    double rep_off = -1;
+    while (hal::nowUs() < end) {
+        // the cutoff may land in an off phase of the slow approach or
+        // between two loop passes (cutoff timer): take the controller's
+        // relay-off time once it stops measuring
+        bool was_measuring = rig.controller.state() == AppState::MEASURING;
+        rig.step();
+        if (was_measuring && rig.controller.state() != AppState::MEASURING &&
+            rep_off < 0)
+            rep_off = (double)(rig.controller.cutoffUs() - base);
+    }
+
+    // settled dose of the recording: mean of its last 0.5 s
+    double t_end = t.ev.back().dt_us;
+    double sum = 0;
+    int n = 0;
+    for (double x = t_end - 500000; x <= t_end; x += 12500, n++)
+        sum += massAt(t, x);
+    r.rec_final_mg = sum / n;
+    r.rec_off_ms = (rec_off - rec_on) / 1000.0;
+
+    // Counterfactual dose for the replayed cutoff: an earlier stop forgoes
+    // the mass recorded in between, a later one adds the recorded stop flow
+    if (rep_off >= 0) {
+        r.cut = true;
+        r.rep_off_ms = (rep_off - rec_on) / 1000.0;
+        if (rep_off <= rec_off) {
+            r.final_mg = r.rec_final_mg -
+                         (massAt(t, rec_off) - massAt(t, rep_off));
+        } else {
+            double flow = (massAt(t, rec_off) - massAt(t, rec_off - 250000)) /
+                          250000.0;  // mg/us
+            r.final_mg = r.rec_final_mg + flow * (rep_off - rec_off);
+        }
+    } else {
+        r.final_mg = r.rec_final_mg;
+    }
+    r.error_mg = r.final_mg - t.h.setpoint_mg;
+    r.overshoot_mg = r.error_mg > 0 ? r.error_mg : 0;
+    return r;
+}
+
+int cmdReplay(int argc, char** argv) {
+    ReplayOptions o;
+    std::vector<Trace> traces;
+    bool quiet = false;
+    for (int i = 0; i < argc; ++i) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--engine") && more) {
+            const char* e = argv[++i];
+            o.tuning.engine = !strcmp(e, "lsq")
+                                  ? Controller::CutoffEngine::LSQ
+                                  : Controller::CutoffEngine::FORMULA;
+        } else if (!strcmp(a, "--tau-comm") && more)
+            o.tau_comm_ms = atof(argv[++i]);
+        else if (!strcmp(a, "--hyst") && more)
+            o.tuning.hysteresis_mg = atoi(argv[++i]);
+        else if (!strcmp(a, "--approach") && more)
+            o.tuning.approach_mg = lround_mg(atof(argv[++i]));
+        else if (!strcmp(a, "--no-timer"))
+            o.tuning.cutoff_timer = false;
+        else if (!strcmp(a, "--no-fast"))
+            o.tuning.fast_cutoff = false;
+        else if (!strcmp(a, "--ot-gain") && more)
+            o.tuning.ot_min_gain = atof(argv[++i]);
+        else if (!strcmp(a, "--kv") && more) {
+            o.kv_override = true;
+            o.kv = atof(argv[++i]);
+        }
+#if SCALE_ESTIMATOR_KALMAN
+        else if (!strcmp(a, "--q") && more)
+            o.kf_fast.q_jerk = atof(argv[++i]);
+        else if (!strcmp(a, "--r") && more)
+            o.kf_fast.r_mg2 = atof(argv[++i]);
+#else
+        else if (!strcmp(a, "--g") && more)
+            o.g = atof(argv[++i]);
+        else if (!strcmp(a, "--h") && more)
+            o.h = atof(argv[++i]);
+#endif
+        else if (!strcmp(a, "-q"))
+            quiet = true;
+        else if (!loadTraces(a, traces)) {
+            fprintf(stderr, "cannot read %s\n", a);
+            return 1;
+        }
+    }
+    if (traces.empty()) {
+        fprintf(stderr,
+                "usage: program replay [--engine formula|lsq] "
+                "[--tau-comm ms] [--hyst mg] [--approach g] [--no-timer] "
+                "[--no-fast] [--ot-gain g] [--kv k] "
+                "[--q q --r r | --g g --h h] [-q] trace...\n");
+        return 2;
+    }
+
+    hal::setSerialEcho(false);
+    auto t0 = std::chrono::steady_clock::now();
+    int n = 0, cut = 0;
+    double sum = 0, sum2 = 0, sum_abs = 0, max_over = 0, virt_s = 0;
+    if (!quiet)
+        printf("%-32s %9s %9s %9s %9s %9s\n", "trace", "rec_off", "rep_off",
+               "rec_fin", "final", "error");
+    for (const Trace& t : traces) {
+        ReplayResult r = replayTrace(t, o);
+        if (!r.valid) continue;
+        n++;
+        cut += r.cut;
+        sum += r.error_mg;
+        sum2 += r.error_mg * r.error_mg;
+        sum_abs += fabs(r.error_mg);
+        if (r.overshoot_mg > max_over) max_over = r.overshoot_mg;
+        virt_s += t.ev.back().dt_us * 1e-6;
+        if (!quiet)
+            printf("%-32s %9.1f %9.1f %9.0f %9.0f %+9.0f%s\n", t.name.c_str(),
+                   r.rec_off_ms, r.rep_off_ms, r.rec_final_mg, r.final_mg,
+                   r.error_mg, r.cut ? "" : "  (no cutoff)");
+    }
+    double wall = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+    if (n == 0) {
+        fprintf(stderr, "no usable traces\n");
+        return 1;
+    }
+    double mean = sum / n;
+    double sd = sqrt(fmax(0.0, sum2 / n - mean * mean));
+    printf("traces=%d cut=%d  error mean=%+.0f sd=%.0f |mean|=%.0f mg  "
+           "max overshoot=%.0f mg\n",
+           n, cut, mean, sd, sum_abs / n, max_over);
+    printf("replayed %.1f s of traces in %.3f s (%.0fx real time)\n", virt_s,
+           wall, wall > 0 ? virt_s / wall : 0.0);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+// Deterministic replay of recorded runs (TraceRecorder dumps) through the
+// real Scale + Controller on the virtual clock.
+#include <string>
+#include <vector>
+
+#include "controller.h"
+#include "trace.h"
+
+struct Trace {
+    std::string name;
+    TraceRecorder::Header h;
+    int32_t offset_counts = 0;
+    std::vector<TraceRecorder::Event> ev;
+};
+
+// All "#trace ... #end" blocks in a text file; other lines (serial log
+// noise) are ignored
+bool loadTraces(const char* path, std::vector<Trace>& out);
+
+struct ReplayOptions {
+    Controller::Tuning tuning;
+#if SCALE_ESTIMATOR_KALMAN
+    KalmanCaEstimator::Noise kf_fast = {KF_Q_JERK_FAST, KF_R_FAST_MG2};
+#else
+    float g = 0.4f, h = 0.08f;  // α–β gains
+#endif
+    float tau_comm_ms = -1;    // actuator latency; -1: as recorded
+    bool kv_override = false;  // replace the recorded table by one seeded
+    float kv = 0.0f;           // from a single k_v (0: empty table)
+};
+
+struct ReplayResult {
+    bool valid = false;      // trace has relay on/off edges
+    bool cut = false;        // replayed controller stopped within the trace
+    double rec_off_ms = 0;   // recorded cutoff, ms after relay on
+    double rep_off_ms = 0;   // replayed cutoff, ms after relay on
+    double rec_final_mg = 0; // settled dose in the recording
+    double final_mg = 0;     // dose predicted for the replayed cutoff
+    double error_mg = 0;     // final - setpoint
+    double overshoot_mg = 0; // max(0, error)
+};
+
+ReplayResult replayTrace(const Trace& t, const ReplayOptions& o);
@@ -0,0 +1,49 @@
+#include "rig.h"
+
+#include "logging.h"
+#include "profiler.h"
+#include "storage.h"
+
+void Rig::begin(hal::LoadCellSource* cell) {
+    hal::attachLoadCell(cell, PIN_HX_DT);
+    storage::begin();
+    display.begin(PIN_MAX_DIN, PIN_MAX_CLK, PIN_MAX_CS);
+    buttons.begin(PIN_BTN_START);
+    encoder.begin(PIN_ENC_A, PIN_ENC_B, PIN_ENC_SW);
+    scale.begin(PIN_HX_DT, PIN_HX_SCK);
+    relay.begin(PIN_RELAY, PIN_RELAY_LED);
+
+    scale.setCalMgPerCountQ16(storage::loadCalQ16(CAL_MG_PER_COUNT_Q16));
+    scale.setTareRaw(storage::loadTareRaw(0));
+    storage::loadProfiles(controller.profiles());
+    storage::loadLatency(relay.actuator(), controller.latency());
+    display.startTask();
+    controller.begin(&scale, &encoder, &buttons, &display, &relay);
+}
+
+void Rig::step() {
+    // loop() wakes on the sampling notification or after 1 ms
+    uint64_t next = hal::nowUs() + 1000;
+    uint64_t t;
+    hal::LoadCellSource* cell = hal::loadCell();
+    if (cell && cell->nextAt(t) && t > hal::nowUs() && t < next) next = t;
+    hal::advanceToUs(next);
+    {
+        PROF_SCOPE(LOOP);
+        controller.update();
+        logging::update();
+        display.update();
+    }
+    loops++;
+}
+
+void Rig::runUntilUs(uint64_t t_us) {
+    while (hal::nowUs() < t_us) step();
+}
+
+void Rig::pressStart(uint32_t holdMs) {
+    hal::setInput(PIN_BTN_START, LOW);
+    runForMs(holdMs);
+    hal::setInput(PIN_BTN_START, HIGH);
+    runForMs(DEBOUNCE_MS + 5);
+}
@@ -0,0 +1,35 @@
+#pragma once
+// Host rig: the firmware objects wired exactly as in main.cpp, running on the
+// virtual hardware of hal_native.h.
+#include "buttons.h"
+#include "config.h"
+#include "controller.h"
+#include "display.h"
+#include "encoder.h"
+#include "hal_native.h"
+#include "relay.h"
+#include "scale.h"
+
+class Rig {
+   public:
+    // Mirrors setup(): storage, display, HID, scale, relay, persisted values
+    void begin(hal::LoadCellSource* cell);
+
+    // One loop() pass: sleep until the next conversion or 1 ms, then update
+    void step();
+    void runUntilUs(uint64_t t_us);
+    void runForMs(uint32_t ms) { runUntilUs(hal::nowUs() + msToUs(ms)); }
+
+    // Hold the start button for holdMs (short press on release)
+    void pressStart(uint32_t holdMs = 80);
+
+    bool relayOn() const { return hal::output(PIN_RELAY) == HIGH; }
+
+    Scale scale;
+    Encoder encoder{UI_LONGPRESS_MS};
+    Buttons buttons{UI_LONGPRESS_MS};
+    Display display;
+    Relay relay;
+    Controller controller;
+    uint32_t loops = 0;
+};
@@ -0,0 +1,240 @@
+// Closed-loop setpoint sweep: Scale + Controller against GrinderSim
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "commands.h"
+#include "grinder_sim.h"
+#include "rig.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "utils.h"
+
+namespace {
+
+// Longest fill the sweep asks of the grinder: larger setpoints get a
+// proportionally higher flow, so they finish well inside the timeout
+constexpr float kMaxFillS = 0.6f * MEASURE_TIMEOUT_MS / 1000.0f;
+
+struct RunResult {
+    float error_mg;
+    bool timed_out;
+    uint8_t topups;
+};
+
+// One dose the way a user pulls it: empty cup, settle, start, wait for the
+// grounds to land and the controller to finish learning
+RunResult runOnce(Rig& rig, GrinderSim& sim, int32_t setpoint_mg) {
+    sim.empty();
+    rig.runForMs(1500);
+    uint64_t t0 = hal::nowUs();
+    rig.pressStart();
+    while (rig.controller.state() == AppState::MEASURING) rig.step();
+    uint64_t dur = hal::nowUs() - t0;
+    rig.runForMs(DONE_HOLD_MS + 1500);
+    // top-up pulses read the settled cup, so the last one has landed too
+    while (rig.controller.state() == AppState::TOPUP_SETTLE ||
+           rig.controller.state() == AppState::TOPUP_PULSE)
+        rig.step();
+    RunResult r;
+    r.error_mg = sim.cupMg() - setpoint_mg;
+    r.timed_out = dur >= msToUs(MEASURE_TIMEOUT_MS);
+    r.topups = rig.controller.topUpPulses();
+    return r;
+}
+
+std::vector<float> parseList(const char* s) {
+    std::vector<float> v;
+    for (char* p = (char*)s; *p;) {
+        v.push_back(strtof(p, &p));
+        if (*p == ',') ++p;
+        else break;
+    }
+    return v;
+}
+
+}  // namespace
+
+int cmdSim(int argc, char** argv) {
+    GrinderSim::Params p = GrinderSim::relayParams();
+    std::vector<float> setpoints = {7, 10, 14, 18, 22, 30, 50, 100, 150, 200};
+    int runs = 20;
+    const char* trace_path = nullptr;
+    const char* telem_path = nullptr;
+    bool plug = false;
+    Controller::Tuning tuning;
+    for (int i = 0; i < argc; ++i) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--plug")) {
+            plug = true;
+        } else if (!strcmp(a, "--engine") && more) {
+            tuning.engine = !strcmp(argv[++i], "lsq")
+                                ? Controller::CutoffEngine::LSQ
+                                : Controller::CutoffEngine::FORMULA;
+        } else if (!strcmp(a, "--fixed-tau")) {
+            tuning.learn_tau = false;
+        } else if (!strcmp(a, "--no-timer")) {
+            tuning.cutoff_timer = false;
+        } else if (!strcmp(a, "--no-fast")) {
+            tuning.fast_cutoff = false;
+        } else if (!strcmp(a, "--approach") && more) {
+            tuning.approach_mg = lround_mg(atof(argv[++i]));
+        } else if (!strcmp(a, "--topup") && more) {
+            tuning.topup_pulses = atoi(argv[++i]);
+        } else if (!strcmp(a, "--runs") && more) {
+            runs = atoi(argv[++i]);
+        } else if (!strcmp(a, "--setpoints") && more) {
+            setpoints = parseList(argv[++i]);
+        } else if (!strcmp(a, "--sps") && more) {
+            p.sps = atoi(argv[++i]);
+        } else if (!strcmp(a, "--flow") && more) {
+            p.flow_gps = atof(argv[++i]);
+        } else if (!strcmp(a, "--noise") && more) {
+            p.noise_mg = atof(argv[++i]);
+        } else if (!strcmp(a, "--burst") && more) {
+            p.burst_sd = atof(argv[++i]);
+        } else if (!strcmp(a, "--seed") && more) {
+            p.seed = atoi(argv[++i]);
+        } else if (!strcmp(a, "--trace-out") && more) {
+            trace_path = argv[++i];
+        } else if (!strcmp(a, "--telemetry-out") && more) {
+            telem_path = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "usage: program sim [--plug] [--engine formula|lsq] "
+                    "[--fixed-tau] [--no-timer] [--no-fast] [--approach g] "
+                    "[--topup n] [--runs n] [--setpoints g,g,..] [--sps 10|80] "
+                    "[--flow gps] [--noise mg] [--burst sd] [--seed n] "
+                    "[--trace-out file] [--telemetry-out file]\n");
+            return 2;
+        }
+    }
+    if (plug) {
+        GrinderSim::Params q = GrinderSim::plugParams();
+        p.on_latency_ms = q.on_latency_ms;
+        p.off_latency_ms = q.off_latency_ms;
+        p.latency_jitter_ms = q.latency_jitter_ms;
+    }
+
+    FILE* trace_file = nullptr;
+    if (trace_path && !(trace_file = fopen(trace_path, "w"))) {
+        fprintf(stderr, "cannot write %s\n", trace_path);
+        return 1;
+    }
+
+    hal::setSerialEcho(false);
+    hal::kvClear();
+    GrinderSim sim(p);
+    Rig rig;
+    rig.begin(&sim);
+    rig.controller.setTuning(tuning);
+    static TraceRecorder trace;
+    if (trace_file) rig.controller.setTraceRecorder(&trace);
+    static TelemetryLog telem;
+    if (telem_path) rig.controller.setTelemetry(&telem);
+
+    printf("actuator=%s engine=%s sps=%u flow=%.2f g/s runs=%d topup=%u\n",
+           plug ? "plug" : "relay",
+           tuning.engine == Controller::CutoffEngine::LSQ ? "lsq" : "formula",
+           (unsigned)p.sps, p.flow_gps, runs, (unsigned)tuning.topup_pulses);
+    printf("%8s %7s %7s %7s %7s %7s %8s %8s %6s %6s %6s\n", "sp_g", "mean",
+           "sd", "p95|e|", "max+", "max-", "timeout", "corr", "tau", "pulses",
+           "flow");
+
+    struct TimedOut {
+        float sp_g;
+        int runs;
+        double sum_mg;
+    };
+    std::vector<TimedOut> timed_out;
+    float worst = -1e9f, worst_sp = 0;
+    for (float sp_g : setpoints) {
+        int32_t sp = lround_mg(sp_g);
+        float flow = fmaxf(p.flow_gps, sp_g / kMaxFillS);
+        sim.setFlowGps(flow);
+        // learned correction at this setpoint and the row's flow (mg)
+        auto corr = [&]() {
+            return rig.controller.overshoot().lookup(flow, sp);
+        };
+        // actuator latency the controller has measured so far (ms)
+        auto tau = [&]() { return rig.controller.latency().ms; };
+        rig.controller.setSetpointMg(sp);
+        std::vector<float> err;
+        int timeouts = 0;
+        double timeout_sum = 0;
+        int pulses = 0;
+        for (int r = 0; r < runs; ++r) {
+            RunResult res = runOnce(rig, sim, sp);
+            pulses += res.topups;
+            if (trace_file) {
+                hal::setSerialFile(trace_file);
+                hal::setSerialEcho(true);
+                trace.dump(Serial);
+                hal::setSerialEcho(false);
+                hal::setSerialFile(nullptr);
+            }
+            if (res.timed_out) {
+                timeouts++;
+                timeout_sum += res.error_mg;
+                continue;
+            }
+            err.push_back(res.error_mg);
+            if (res.error_mg > worst) {
+                worst = res.error_mg;
+                worst_sp = sp_g;
+            }
+        }
+        if (timeouts) timed_out.push_back({sp_g, timeouts, timeout_sum});
+        if (err.empty()) {
+            printf("%8.1f %7s %7s %7s %7s %7s %8d %8.0f %6.1f %6.2f %6.2f\n",
+                   sp_g, "-", "-", "-", "-", "-", timeouts, corr(), tau(),
+                   (float)pulses / runs, flow);
+            continue;
+        }
+        double sum = 0, sum2 = 0;
+        std::vector<float> mag;
+        for (float e : err) {
+            sum += e;
+            sum2 += (double)e * e;
+            mag.push_back(fabsf(e));
+        }
+        std::sort(mag.begin(), mag.end());
+        double mean = sum / err.size();
+        double sd = sqrt(fmax(0.0, sum2 / err.size() - mean * mean));
+        float p95 = mag[(size_t)(0.95 * (mag.size() - 1) + 0.5)];
+        float hi = *std::max_element(err.begin(), err.end());
+        float lo = *std::min_element(err.begin(), err.end());
+        printf(
+            "%8.1f %+7.0f %7.0f %7.0f %+7.0f %+7.0f %8d %8.0f %6.1f %6.2f "
+            "%6.2f\n",
+            sp_g, mean, sd, p95, hi, lo, timeouts, corr(), tau(),
+            (float)pulses / runs, flow);
+    }
+    if (worst > -1e9f)
+        printf("worst-case overshoot %+.0f mg at %.1f g\n", worst, worst_sp);
+    // not in the statistics above: the relay was cut by the timeout
+    for (const TimedOut& t : timed_out)
+        printf("timed out at %.1f g: %d runs, mean error %+.0f mg\n", t.sp_g,
+               t.runs, t.sum_mg / t.runs);
+    if (trace_file) fclose(trace_file);
+    if (telem_path) {
+        // the last TELEMETRY_RUNS runs, as the serial "b" command sends them
+        FILE* f = fopen(telem_path, "wb");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", telem_path);
+            return 1;
+        }
+        hal::setSerialFile(f);
+        hal::setSerialEcho(true);
+        telem.dump(Serial);
+        hal::setSerialEcho(false);
+        hal::setSerialFile(nullptr);
+        fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "overshoot_table.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+namespace {
+constexpr uint8_t kMagic0 = 'O', kMagic1 = 'T', kVersion = 1;
+constexpr float kConfScale = 8.0f;  // confidence stored as uint8 / 8
+}  // namespace
+
+void OvershootTable::clear() {
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i) corr_[b][i] = conf_[b][i] = 0.0f;
+}
+
+void OvershootTable::seedFromKv(float kv) {
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i) {
+            corr_[b][i] = kv * binFlowGps(i);
+            conf_[b][i] = kv != 0.0f ? 1.0f : 0.0f;
+        }
+}
+
+void OvershootTable::weaken() {
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i)
+            if (conf_[b][i] > 1.0f) conf_[b][i] = 1.0f;
+}
+
+void OvershootTable::shiftForLatency(float dtau_ms) {
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i)
+            if (conf_[b][i] > 0.0f) corr_[b][i] -= binFlowGps(i) * dtau_ms;
+}
+
+float OvershootTable::binFlowGps(uint8_t bin) const {
+    return OT_FLOW_MIN_GPS +
+           (OT_FLOW_MAX_GPS - OT_FLOW_MIN_GPS) * bin / (kBins - 1);
+}
+
+uint8_t OvershootTable::band(int32_t setpoint_mg) {
+    uint8_t b = 0;
+    while (b < kBands - 1 && setpoint_mg >= OT_SP_EDGES_G[b] * 1000.0f) b++;
+    return b;
+}
+
+void OvershootTable::locate(float v_gps, uint8_t& i, float& frac) {
+    float x = (v_gps - OT_FLOW_MIN_GPS) * (kBins - 1) /
+              (OT_FLOW_MAX_GPS - OT_FLOW_MIN_GPS);
+    if (x <= 0.0f) x = 0.0f;
+    if (x >= kBins - 1) x = kBins - 1;
+    i = (uint8_t)x;
+    if (i >= kBins - 1) i = kBins - 2;
+    frac = x - i;
+}
+
+float OvershootTable::effective(uint8_t b, uint8_t bin) const {
+    if (conf_[b][bin] > 0.0f) return corr_[b][bin];
+    // nearest learned bin, own band first, then the closest other band
+    for (uint8_t db = 0; db < kBands; ++db) {
+        for (int sgn = -1; sgn <= 1; sgn += 2) {
+            int bb = b + sgn * db;
+            if (bb < 0 || bb >= kBands || (db == 0 && sgn > 0)) continue;
+            for (int d = 0; d < kBins; ++d) {
+                if (bin - d >= 0 && conf_[bb][bin - d] > 0.0f)
+                    return corr_[bb][bin - d];
+                if (bin + d < kBins && conf_[bb][bin + d] > 0.0f)
+                    return corr_[bb][bin + d];
+            }
+        }
+    }
+    return 0.0f;
+}
+
+float OvershootTable::lookup(float v_gps, int32_t setpoint_mg) const {
+    uint8_t b = band(setpoint_mg), i;
+    float f;
+    locate(v_gps, i, f);
+    return (1.0f - f) * effective(b, i) + f * effective(b, i + 1);
+}
+
+void OvershootTable::learn(float v_gps, int32_t setpoint_mg, float eps_mg,
+                           float min_gain) {
+    uint8_t b = band(setpoint_mg), i;
+    float f;
+    locate(v_gps, i, f);
+    const float w[2] = {1.0f - f, f};
+    // start unlearned bins from what the cutoff actually used
+    const float base[2] = {effective(b, i), effective(b, i + 1)};
+    for (uint8_t k = 0; k < 2; ++k) {
+        if (w[k] <= 0.0f) continue;
+        float& c = conf_[b][i + k];
+        float gain = w[k] / (c + w[k]);
+        if (gain < min_gain * w[k]) gain = min_gain * w[k];
+        corr_[b][i + k] = base[k] + gain * eps_mg;
+        c += w[k];
+        if (c > OT_CONF_MAX) c = OT_CONF_MAX;
+    }
+}
+
+uint8_t OvershootTable::learnedBins() const {
+    uint8_t n = 0;
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i) n += conf_[b][i] > 0.0f;
+    return n;
+}
+
+void OvershootTable::serialize(uint8_t out[kBlobSize]) const {
+    uint8_t* p = out;
+    *p++ = kMagic0;
+    *p++ = kMagic1;
+    *p++ = kVersion;
+    *p++ = kBins;
+    *p++ = kBands;
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i) {
+            long mg = lroundf(corr_[b][i]);
+            if (mg > INT16_MAX) mg = INT16_MAX;
+            if (mg < INT16_MIN) mg = INT16_MIN;
+            uint16_t u = (uint16_t)(int16_t)mg;
+            *p++ = u & 0xFF;
+            *p++ = u >> 8;
+            float c = conf_[b][i] * kConfScale;
+            // a learned bin never rounds down to "unlearned"
+            *p++ = conf_[b][i] > 0.0f ? (uint8_t)fmaxf(1.0f, fminf(c, 255.0f))
+                                      : 0;
+        }
+}
+
+bool OvershootTable::deserialize(const uint8_t* in, size_t len) {
+    if (len != kBlobSize || in[0] != kMagic0 || in[1] != kMagic1 ||
+        in[2] != kVersion || in[3] != kBins || in[4] != kBands)
+        return false;
+    const uint8_t* p = in + 5;
+    for (uint8_t b = 0; b < kBands; ++b)
+        for (uint8_t i = 0; i < kBins; ++i) {
+            corr_[b][i] = (int16_t)(uint16_t)(p[0] | (p[1] << 8));
+            conf_[b][i] = p[2] / kConfScale;
+            p += 3;
+        }
+    return true;
+}
@@ -0,0 +1,70 @@
+#include "profiler.h"
+
+#if PROFILER
+namespace prof {
+namespace {
+Stats stats_[(uint8_t)Scope::COUNT];
+
+const char* const kNames[(uint8_t)Scope::COUNT] = {
+    "loop", "hx711 read", "estimator", "stability",
+    "cutoff", "display", "encoder+buttons", "nvs write"};
+
+uint32_t cyclesPerUs() {
+#if defined(__x86_64__) || defined(__i386__)
+    return 0;  // TSC rate unknown on the host, report cycles only
+#else
+    return ESP.getCpuFreqMHz();
+#endif
+}
+}  // namespace
+
+void record(Scope s, uint32_t c) {
+    Stats& st = stats_[(uint8_t)s];
+    st.n++;
+    st.sum += c;
+    if (c < st.min) st.min = c;
+    if (c > st.max) st.max = c;
+    // bucket b holds [2^(b+PROF_BUCKET0_LOG2), 2^(b+PROF_BUCKET0_LOG2+1))
+    int b = c ? 31 - __builtin_clz(c) - PROF_BUCKET0_LOG2 : 0;
+    if (b < 0) b = 0;
+    if (b >= PROF_BUCKETS) b = PROF_BUCKETS - 1;
+    st.hist[b]++;
+}
+
+const Stats& stats(Scope s) { return stats_[(uint8_t)s]; }
+
+void report(HardwareSerial& out) {
+    uint32_t mhz = cyclesPerUs();
+    out.printf("%-16s %8s %9s %9s %9s %9s\n", "scope (cycles)", "n", "min",
+               "mean", "max", "mean us");
+    for (uint8_t i = 0; i < (uint8_t)Scope::COUNT; ++i) {
+        // snapshot first: sampling-task scopes keep counting meanwhile, so a
+        // sample landing during the reset may be lost
+        Stats st = stats_[i];
+        stats_[i] = Stats();
+        if (!st.n) continue;
+        uint32_t mean = (uint32_t)(st.sum / st.n);
+        out.printf("%-16s %8lu %9lu %9lu %9lu", kNames[i],
+                   (unsigned long)st.n, (unsigned long)st.min,
+                   (unsigned long)mean, (unsigned long)st.max);
+        if (mhz)
+            out.printf(" %9.1f\n", (double)mean / mhz);
+        else
+            out.printf(" %9s\n", "-");
+        // histogram: <upper bound in cycles>:count for the used buckets,
+        // the last one open-ended
+        out.printf("%-16s", "");
+        for (uint8_t b = 0; b < PROF_BUCKETS; ++b) {
+            if (!st.hist[b]) continue;
+            bool last = b == PROF_BUCKETS - 1;
+            out.printf(" %s%lu:%lu", last ? ">=" : "<",
+                       (unsigned long)((last ? 1UL : 2UL)
+                                       << (b + PROF_BUCKET0_LOG2)),
+                       (unsigned long)st.hist[b]);
+        }
+        out.printf("\n");
+    }
+}
+
+}  // namespace prof
+#endif
@@ -0,0 +1,110 @@
+#include "profiles.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr uint8_t kMagic0 = 'P', kMagic1 = 'F', kVersion = 4;
+// v1 records: name, setpoint, tau ms (uint16), table
+constexpr size_t kRecordSizeV1 =
+    PROFILE_NAME_LEN + 4 + 2 + OvershootTable::kBlobSize;
+// v3 records: v4 plus tau and its deviation (uint16, 0.1 ms) and tau runs
+// after the setpoint
+constexpr size_t kRecordSizeV3 = ProfileStore::kRecordSize + 2 + 2 + 1;
+static_assert(5 + kRecordSizeV3 * ProfileStore::kCount ==
+                  ProfileStore::kMaxBlobSize,
+              "kMaxBlobSize must hold a version 3 blob");
+// v2 records: v3 without the pulse model
+constexpr size_t kRecordSizeV2 = kRecordSizeV3 - 2 - 1;
+
+void putU16(uint8_t*& p, float v, float scale) {
+    long u = lroundf(v * scale);
+    if (u < 0) u = 0;
+    if (u > UINT16_MAX) u = UINT16_MAX;
+    *p++ = u & 0xFF;
+    *p++ = (u >> 8) & 0xFF;
+}
+
+uint16_t getU16(const uint8_t*& p) {
+    uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+    p += 2;
+    return v;
+}
+}  // namespace
+
+void ProfileStore::reset() {
+    for (uint8_t i = 0; i < kCount; ++i) {
+        Profile& p = p_[i];
+        memset(p.name, 0, sizeof p.name);
+        for (uint8_t c = 0; c < PROFILE_NAME_LEN && PROFILE_NAMES[i][c]; ++c)
+            p.name[c] = PROFILE_NAMES[i][c];
+        p.setpoint_mg = (int32_t)(PROFILE_SETPOINTS_G[i] * 1000.0f + 0.5f);
+        p.ot.clear();
+        p.pulse.reset();
+    }
+    active_ = 0;
+}
+
+void ProfileStore::serialize(uint8_t out[kBlobSize]) const {
+    uint8_t* p = out;
+    *p++ = kMagic0;
+    *p++ = kMagic1;
+    *p++ = kVersion;
+    *p++ = kCount;
+    *p++ = active_;
+    for (uint8_t i = 0; i < kCount; ++i) {
+        const Profile& pr = p_[i];
+        memcpy(p, pr.name, PROFILE_NAME_LEN);
+        p += PROFILE_NAME_LEN;
+        uint32_t sp = (uint32_t)pr.setpoint_mg;
+        for (int b = 0; b < 4; ++b) *p++ = (sp >> (8 * b)) & 0xFF;
+        pr.ot.serialize(p);
+        p += OvershootTable::kBlobSize;
+        putU16(p, pr.pulse.mg_per_ms, 1000.0f);
+        *p++ = pr.pulse.pulses;
+    }
+}
+
+bool ProfileStore::deserialize(const uint8_t* in, size_t len) {
+    if (len < 5 || in[0] != kMagic0 || in[1] != kMagic1 || in[3] != kCount ||
+        in[4] >= kCount)
+        return false;
+    uint8_t ver = in[2];
+    if (!(ver == kVersion && len == kBlobSize) &&
+        !(ver == 3 && len == 5 + kRecordSizeV3 * kCount) &&
+        !(ver == 2 && len == 5 + kRecordSizeV2 * kCount) &&
+        !(ver == 1 && len == 5 + kRecordSizeV1 * kCount))
+        return false;
+    // parse into a copy so a bad record leaves the store untouched
+    Profile tmp[kCount];
+    const uint8_t* p = in + 5;
+    for (uint8_t i = 0; i < kCount; ++i) {
+        Profile& pr = tmp[i];
+        memcpy(pr.name, p, PROFILE_NAME_LEN);
+        pr.name[PROFILE_NAME_LEN] = '\0';
+        p += PROFILE_NAME_LEN;
+        uint32_t sp = 0;
+        for (int b = 0; b < 4; ++b) sp |= (uint32_t)*p++ << (8 * b);
+        pr.setpoint_mg = (int32_t)sp;
+        float tau_ms = TAU_COMM_MS;
+        if (ver == 1) {
+            tau_ms = getU16(p);
+        } else if (ver <= 3) {
+            tau_ms = getU16(p) / 10.0f;
+            p += 2 + 1;  // deviation, runs
+        }
+        if (!pr.ot.deserialize(p, OvershootTable::kBlobSize)) return false;
+        p += OvershootTable::kBlobSize;
+        // the old per-profile latency included the coast-down tail; hand its
+        // flow-proportional share back to the table, the learned latency
+        // restarts from TAU_COMM_MS
+        if (ver < kVersion) pr.ot.shiftForLatency(TAU_COMM_MS - tau_ms);
+        if (ver >= 3) {
+            pr.pulse.mg_per_ms = getU16(p) / 1000.0f;
+            pr.pulse.pulses = *p++;
+        }
+    }
+    for (uint8_t i = 0; i < kCount; ++i) p_[i] = tmp[i];
+    active_ = in[4];
+    return true;
+}
@@ -3,13 +3,19 @@
 #include <limits.h>
 #include <math.h>
 
+#include "fast_cutoff.h"
+#include "logging.h"
+#include "profiler.h"
 #include "utils.h"
 
 Scale* Scale::instance_ = nullptr;
 
 void Scale::begin(uint8_t dtPin, uint8_t sckPin) {
     dt_pin_ = dtPin;
-    hx_.begin(dt_pin_, sckPin);
+    if (!hx_.begin(dt_pin_, sckPin, (Hx711::Gain)HX711_GAIN_PULSES)) {
+        ok_ = false;  // SPI bus unavailable; update() keeps reporting Err
+        return;
+    }
     delay(400);  // settle
     instance_ = this;
     attachInterrupt(digitalPinToInterrupt(dt_pin_), Scale::drdyISR, FALLING);
@@ -17,66 +23,140 @@ void Scale::begin(uint8_t dtPin, uint8_t sckPin) {
     ok_ = true;
     cal_q16_ = CAL_MG_PER_COUNT_Q16;  // runtime factor starts from config (Q16)
     setSamplePeriodMs(HX711_PERIOD_IDLE_MS);
-    last_sample_ms_ = millis();
+    last_sample_us_ = monoUs();
+
+    // Dedicated sampling task; if it cannot be created update() polls instead
+    if (xTaskCreatePinnedToCore(taskThunk, "ScaleSampler", SCALE_TASK_STACK,
+                                this, SCALE_TASK_PRIORITY, &task_,
+                                SCALE_TASK_CORE) != pdPASS) {
+        task_ = nullptr;
+    }
 }
 
 void Scale::setSamplePeriodMs(uint16_t ms) { period_ms_ = (ms == 0) ? 1 : ms; }
 
 void Scale::tare() {
     // Capture current raw as new baseline; allows negative readings later
-    tare_raw_ = weight_raw_ + tare_raw_;
+    setTareRaw(rawNoTare());
+}
+
+Scale::Sample Scale::latest() const {
+    portENTER_CRITICAL(&mux_);
+    Sample s = pub_;
+    portEXIT_CRITICAL(&mux_);
+    return s;
 }
 
 void Scale::update() {
-    uint32_t now = millis();
+    uint64_t now = monoUs();
 
     uint16_t timeout_base_ms =
         (period_ms_ > HX711_PERIOD_IDLE_MS) ? period_ms_ : HX711_PERIOD_IDLE_MS;
     uint32_t timeout_ms =
         (uint32_t)timeout_base_ms * NOTREADY_MULT + NOTREADY_MARGIN_MS;
-    if (last_sample_ms_ != 0 && (now - last_sample_ms_) > timeout_ms) {
+    portENTER_CRITICAL(&mux_);
+    uint64_t last = last_sample_us_;
+    portEXIT_CRITICAL(&mux_);
+    if (last != 0 && now > last && (now - last) > msToUs(timeout_ms)) {
         ok_ = false;
     }
 
-    // wait for DRDY interrupt
-    if (!drdy_pending_) return;
+    // samples are consumed by the sampling task when it runs
+    if (task_) return;
 
+    // non-blocking two-phase readout: start one when a conversion waits...
+    if (!hx_.busy() && (drdy_pending_ || hx_.isReady())) {
+        // ISR stamp, or now if the edge was missed (e.g. before attach)
+        read_t_us_ = drdy_pending_ ? drdy_us_ : now;
+        hx_.startRead();
+    }
+
+    // ...and collect it once the transfer finished (usually next call)
+    if (!hx_.busy()) return;
+    int32_t raw;
+    bool done;
+    {
+        PROF_SCOPE(HX_READ);
+        done = hx_.completeRead(raw);
+    }
+    if (!done) return;
     // enforce requested sampling period (decimate if HX711 is faster)
-    if (last_sample_ms_ != 0 && (now - last_sample_ms_) < period_ms_) return;
+    if (!decimating(read_t_us_)) acquire(raw, read_t_us_);
+    drdy_pending_ = false;  // re-arm the ISR timestamp
+}
 
-    drdy_pending_ = false;
+void Scale::taskThunk(void* self) { static_cast<Scale*>(self)->taskLoop(); }
+
+void Scale::taskLoop() {
+    for (;;) {
+        // Block until DRDY; the timeout only recovers from a missed edge
+        uint32_t timeout_ms =
+            (uint32_t)HX711_PERIOD_IDLE_MS * NOTREADY_MULT + NOTREADY_MARGIN_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+        if (!hx_.isReady()) {
+            drdy_pending_ = false;
+            continue;
+        }
+
+        // ISR stamp, or now if we woke on the timeout after a missed edge
+        uint64_t t_us = drdy_pending_ ? drdy_us_ : monoUs();
+
+        // Sleep on the SPI interrupt while the peripheral clocks the word out.
+        // Too-early conversions are still read so the HX711 releases DOUT and
+        // raises the next DRDY edge, but the value is dropped (decimation).
+        int32_t raw;
+        bool done;
+        {
+            PROF_SCOPE(HX_READ);
+            done = hx_.startRead() && hx_.completeRead(raw, portMAX_DELAY);
+        }
+        if (done && !decimating(t_us)) acquire(raw, t_us);
+        // discard stray edges and re-arm the ISR timestamp for the next DRDY
+        ulTaskNotifyTake(pdTRUE, 0);
+        drdy_pending_ = false;
+    }
+}
+
+void Scale::acquire(int32_t raw, uint64_t now_us) {
     ok_ = true;
 
     // debug: measure actual samples per second
-    /*
-    static uint32_t dbg_count = 0;
-    static uint32_t dbg_window_start = millis();
-    dbg_count++;
-    uint32_t win_ms = now - dbg_window_start;
-    if (win_ms >= 1000) {  // 1 s window
-        float sps = (win_ms > 0) ? (1000.0f * dbg_count / (float)win_ms) : 0.0f;
-        Serial.printf("HX711 SPS: %.1f\n", sps);
-        dbg_count = 0;
-        dbg_window_start = now;
+    if (logging::compiled(logging::Level::DEBUG, logging::Module::SCALE)) {
+        static uint32_t dbg_count = 0;
+        static uint64_t dbg_window_start = now_us;
+        dbg_count++;
+        uint64_t win_us = now_us - dbg_window_start;
+        if (win_us >= 1000000) {  // 1 s window
+            float sps = 1e6f * dbg_count / (float)win_us;
+            LOGF(DEBUG, SCALE, "HX711 SPS: %.1f", sps);
+            dbg_count = 0;
+            dbg_window_start = now_us;
+        }
     }
-    */
 
-    uint32_t prev_sample_ms = last_sample_ms_;
-    int32_t raw = hx_.read();
-    last_sample_ms_ = now;
+    processSample(raw, now_us);
+}
+
+void Scale::processSample(int32_t raw, uint64_t now_us) {
+    // only this task writes it, so its own read needs no lock
+    uint64_t prev_sample_us = last_sample_us_;
+    portENTER_CRITICAL(&mux_);
+    last_sample_us_ = now_us;
+    portEXIT_CRITICAL(&mux_);
 
-    raw -= SCALE_OFFSET_COUNTS;     // compile-time raw offset
-    last_raw_no_tare_ = raw;        // save before tare
-    weight_raw_ = raw - tare_raw_;  // allow negative
+    raw -= SCALE_OFFSET_COUNTS;  // compile-time raw offset
+    last_raw_no_tare_.store(raw, std::memory_order_relaxed);  // before tare
+    int32_t weight_raw = raw - tareRaw();  // allow negative
+    weight_raw_.store(weight_raw, std::memory_order_relaxed);
 
     // --- Convert counts -> mg ---
     // fast measurement (no median)
     int32_t mg_fast =
-        (int32_t)(((int64_t)weight_raw_ * (int64_t)cal_q16_) >> 16);
+        (int32_t)(((int64_t)weight_raw * (int64_t)cal_q16_) >> 16);
     mg_fast += SCALE_OFFSET_MG;  // optional mg-level offset
 
     // slow/display path with median-of-3 + IIR
-    buf_[bi_] = weight_raw_;
+    buf_[bi_] = weight_raw;
     bi_ = (bi_ + 1) % 3;
     int32_t med = med3(buf_[0], buf_[1], buf_[2]);
     int32_t mg_slow = (int32_t)(((int64_t)med * (int64_t)cal_q16_) >> 16);
@@ -84,78 +164,88 @@ void Scale::update() {
     filt_mg_ += (mg_slow - filt_mg_) / IIR_ALPHA_DIV;  // IIR alpha=1/N
     last_mg_ = filt_mg_;
 
-    // ---- Fast α–β estimator (x,v) with accel EMA ----
-    uint32_t dt_ms =
-        (prev_sample_ms == 0) ? period_ms_ : (now - prev_sample_ms);
-    float dt = dt_ms / 1000.0f;
-    if (dt <= 0.0001f) dt = period_ms_ / 1000.0f;
-    // predict
-    float x_pred = x_hat_mg_ + v_hat_mgps_ * dt;
-    float v_pred = v_hat_mgps_;
-    // update
-    float r = (float)mg_fast - x_pred;
-    x_hat_mg_ = x_pred + g_ * r;
-    v_hat_mgps_ = v_pred + (h_ / dt) * r;
-    // accel estimate (EMA of dv/dt)
-    float dv = v_hat_mgps_ - last_v_hat_;
-    float a_inst = dv / dt;
-    a_hat_mgps2_ = 0.8f * a_hat_mgps2_ + 0.2f * a_inst;
-    last_v_hat_ = v_hat_mgps_;
-
-    // ---- Stability detection (on slow path) ----
-    if (wcount_ < STAB_WINDOW_SAMPLES) wcount_++;
-    win_[widx_] = last_mg_;
-    widx_ = (widx_ + 1) % STAB_WINDOW_SAMPLES;
-
-    if (wcount_ == STAB_WINDOW_SAMPLES) {
-        int64_t sum = 0;
-        int32_t mn = INT32_MAX, mx = INT32_MIN;
-
-        // Compute sum, min, max, mean
-        for (uint8_t i = 0; i < STAB_WINDOW_SAMPLES; ++i) {
-            int32_t v = win_[i];
-            sum += v;
-            if (v < mn) mn = v;
-            if (v > mx) mx = v;
-        }
-        float mean = (float)sum / STAB_WINDOW_SAMPLES;
-
-        // Compute variance
-        float var_sum = 0.0f;
-        for (uint8_t i = 0; i < STAB_WINDOW_SAMPLES; ++i) {
-            float diff = win_[i] - mean;
-            var_sum += diff * diff;
-        }
-
-        // Population variance (divide by N)
-        float var = var_sum / STAB_WINDOW_SAMPLES;
-        if (var < 0.0f) var = 0.0f;
+    // ---- Fast estimator (x, v, a) ----
+    uint64_t dt_us = (prev_sample_us == 0 || now_us <= prev_sample_us)
+                         ? msToUs(period_ms_)
+                         : (now_us - prev_sample_us);
+    if (dt_us <= 100) dt_us = msToUs(period_ms_);
+    if (dt_us > UINT32_MAX) dt_us = UINT32_MAX;
+    {
+        PROF_SCOPE(ESTIMATOR);
+#if SCALE_ESTIMATOR_KALMAN
+        // grinding needs a fast, agile filter; at rest a smoother one
+        est_.setNoise(period_ms_ <= HX711_PERIOD_FAST_MS ? kf_fast_
+                                                          : kf_idle_);
+#endif
+        // dt-dependent gains come from the estimator's per-rate table
+        est_.update((float)mg_fast, (uint32_t)dt_us);
+    }
 
-        // Standard deviation
-        int32_t stdmg = (int32_t)sqrtf(var);
+    updateStability(now_us);
+    publish(now_us);
+}
 
-        // Peak-to-peak
-        int32_t p2p = mx - mn;
+void Scale::updateStability(uint64_t now_us) {
+    PROF_SCOPE(STABILITY);
+    // ---- Stability detection (on slow path) ----
+    stab_.push(now_us, last_mg_);
 
+    if (stab_.full()) {
         // Check stability criteria
-        bool quiet = (stdmg <= STAB_STDDEV_MG) && (p2p <= STAB_P2P_MG);
+        bool quiet = stab_.stddevWithin(STAB_STDDEV_MG) &&
+                     (stab_.peakToPeak() <= STAB_P2P_MG);
 
         // Update stable state with dwell time
         if (quiet) {
-            if (stable_since_ == 0) {
-                stable_since_ = now;
+            if (stable_since_us_ == 0) {
+                stable_since_us_ = now_us;
             }
-            stable_ = (now - stable_since_) >= STAB_DWELL_MS;
+            stable_ = (now_us - stable_since_us_) >= msToUs(STAB_DWELL_MS);
         } else {
             stable_ = false;
-            stable_since_ = 0;  // reset so next quiet period starts timing
+            stable_since_us_ = 0;  // reset so next quiet period starts timing
         }
     } else {
         stable_ = false;  // not enough samples yet
-        stable_since_ = 0;
+        stable_since_us_ = 0;
     }
 }
 
+void Scale::publish(uint64_t now_us) {
+    Sample s;
+    s.seq = ++seq_;
+    s.t_us = now_us;
+    s.raw = rawCounts();
+    s.x_mg = (int32_t)est_.x();
+    s.v_mgps = est_.v();
+    s.a_mgps2 = est_.a();
+    s.filt_mg = filt_mg_;
+    s.stable = stable_;
+
+    // relay off first, the controller learns about it from the ring
+    if (cutoff_) cutoff_->check(s.seq, s.t_us, s.x_mg, s.v_mgps, s.a_mgps2);
+
+    ring_.push(s);  // drop is visible to the consumer as a seq gap
+
+    portENTER_CRITICAL(&mux_);
+    pub_ = s;
+    portEXIT_CRITICAL(&mux_);
+
+    // wake the consumer so the cutoff runs on this sample right away
+    if (consumer_) xTaskNotifyGive(consumer_);
+}
+
 void IRAM_ATTR Scale::drdyISR() {
-    if (instance_) instance_->drdy_pending_ = true;
+    if (!instance_) return;
+    // first edge wins; edges caused by clocking out data are ignored until
+    // the reader re-arms drdy_pending_
+    if (!instance_->drdy_pending_) {
+        instance_->drdy_us_ = monoUs();
+        instance_->drdy_pending_ = true;
+    }
+    if (instance_->task_) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(instance_->task_, &woken);
+        if (woken == pdTRUE) portYIELD_FROM_ISR();
+    }
 }
@@ -0,0 +1,65 @@
+#include "stability.h"
+
+void StabilityDetector::setWindowMs(uint32_t ms) {
+    win_us_ = ms * 1000u;
+    reset();
+}
+
+void StabilityDetector::reset() {
+    head_ = tail_ = 0;
+    min_h_ = min_t_ = max_h_ = max_t_ = 0;
+    sum_ = sumsq_ = 0;
+    primed_ = span_ok_ = false;
+}
+
+void StabilityDetector::popOldest() {
+    const Entry& e = buf_[tail_ & kMask];
+    sum_ -= e.mg;
+    sumsq_ -= (int64_t)e.mg * e.mg;
+    if (min_t_ != min_h_ && minq_[min_t_ & kMask] == tail_) min_t_++;
+    if (max_t_ != max_h_ && maxq_[max_t_ & kMask] == tail_) max_t_++;
+    tail_++;
+}
+
+void StabilityDetector::push(uint64_t t_us, int32_t mg) {
+    const uint32_t t = (uint32_t)t_us;
+    if (!primed_) {
+        first_us_ = t;
+        primed_ = true;
+    }
+    if (!span_ok_ && t - first_us_ >= win_us_) span_ok_ = true;
+
+    // keep readings in (t - window, t], and room for this one
+    while (head_ != tail_ && (t - buf_[tail_ & kMask].t_us >= win_us_ ||
+                              head_ - tail_ >= kCap))
+        popOldest();
+
+    buf_[head_ & kMask] = {t, mg};
+    sum_ += mg;
+    sumsq_ += (int64_t)mg * mg;
+
+    // drop entries that can no longer be the min / max
+    while (min_h_ != min_t_ && buf_[minq_[(min_h_ - 1) & kMask] & kMask].mg >= mg)
+        min_h_--;
+    minq_[min_h_++ & kMask] = head_;
+    while (max_h_ != max_t_ && buf_[maxq_[(max_h_ - 1) & kMask] & kMask].mg <= mg)
+        max_h_--;
+    maxq_[max_h_++ & kMask] = head_;
+
+    head_++;
+}
+
+int32_t StabilityDetector::peakToPeak() const {
+    if (head_ == tail_) return 0;
+    return buf_[maxq_[max_t_ & kMask] & kMask].mg -
+           buf_[minq_[min_t_ & kMask] & kMask].mg;
+}
+
+bool StabilityDetector::stddevWithin(int32_t stddev_mg) const {
+    // var = sumsq/n - (sum/n)^2  =>  n*sumsq - sum^2 < (s+1)^2 * n^2
+    int64_t n = head_ - tail_;
+    if (n == 0) return true;
+    int64_t m2 = n * sumsq_ - sum_ * sum_;
+    int64_t lim = (int64_t)(stddev_mg + 1) * (stddev_mg + 1);
+    return m2 < lim * n * n;
+}
@@ -2,8 +2,11 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <math.h>
 
 #include "config.h"
+#include "logging.h"
+#include "profiler.h"
 
 namespace storage {
 static Preferences prefs;
@@ -11,19 +14,10 @@ static Preferences prefs;
 static void logPersist(const char* key, int32_t prev, bool hadPrev,
                        int32_t value) {
     if (!hadPrev) {
-        Serial.printf("Persist %s = %ld (new)\n", key, (long)value);
+        LOGF(INFO, STORAGE, "Persist %s = %ld (new)", key, (long)value);
     } else if (prev != value) {
-        Serial.printf("Persist %s: %ld -> %ld\n", key, (long)prev,
-                      (long)value);
-    }
-}
-
-static void logPersist(const char* key, float prev, bool hadPrev, float value) {
-    if (!hadPrev) {
-        Serial.printf("Persist %s = %.4f (new)\n", key, (double)value);
-    } else if (prev != value) {
-        Serial.printf("Persist %s: %.4f -> %.4f\n", key, (double)prev,
-                      (double)value);
+        LOGF(INFO, STORAGE, "Persist %s: %ld -> %ld", key, (long)prev,
+             (long)value);
     }
 }
 
@@ -33,7 +27,10 @@ int32_t loadCalQ16(int32_t def) { return prefs.getInt(KEY_CAL_Q16, def); }
 void saveCalQ16(int32_t v) {
     bool hadPrev = prefs.isKey(KEY_CAL_Q16);
     int32_t prev = prefs.getInt(KEY_CAL_Q16, v);
-    prefs.putInt(KEY_CAL_Q16, v);
+    {
+        PROF_SCOPE(NVS);
+        prefs.putInt(KEY_CAL_Q16, v);
+    }
     logPersist(KEY_CAL_Q16, prev, hadPrev, v);
 }
 
@@ -41,23 +38,84 @@ int32_t loadTareRaw(int32_t def) { return prefs.getInt(KEY_TARE_RAW, def); }
 void saveTareRaw(int32_t v) {
     bool hadPrev = prefs.isKey(KEY_TARE_RAW);
     int32_t prev = prefs.getInt(KEY_TARE_RAW, v);
-    prefs.putInt(KEY_TARE_RAW, v);
+    {
+        PROF_SCOPE(NVS);
+        prefs.putInt(KEY_TARE_RAW, v);
+    }
     logPersist(KEY_TARE_RAW, prev, hadPrev, v);
 }
 
-int32_t loadSetpointMg(int32_t def) { return prefs.getInt(KEY_SETPOINT, def); }
-void saveSetpointMg(int32_t v) {
-    bool hadPrev = prefs.isKey(KEY_SETPOINT);
-    int32_t prev = prefs.getInt(KEY_SETPOINT, v);
-    prefs.putInt(KEY_SETPOINT, v);
-    logPersist(KEY_SETPOINT, prev, hadPrev, v);
+static void dropLegacyKeys() {
+    static const char* const legacy[] = {KEY_SETPOINT, KEY_OT, KEY_KV};
+    for (const char* key : legacy)
+        if (prefs.isKey(key)) prefs.remove(key);
+}
+
+bool loadProfiles(ProfileStore& p) {
+    static uint8_t blob[ProfileStore::kMaxBlobSize];
+    size_t n = prefs.getBytes(KEY_PROFILES, blob, sizeof blob);
+    if (n > 0 && p.deserialize(blob, n)) {  // any known version
+        // an older layout is converted once, not on every boot
+        if (n != ProfileStore::kBlobSize) {
+            LOGF(INFO, STORAGE, "Converted profiles to the current layout");
+            saveProfiles(p);
+        }
+        dropLegacyKeys();
+        return true;
+    }
+    p.reset();
+
+    // firmware before profiles kept one setpoint and one table / k_v
+    Profile& first = p.at(0);
+    bool migrated = false;
+    if (prefs.isKey(KEY_SETPOINT)) {
+        first.setpoint_mg = prefs.getInt(KEY_SETPOINT, first.setpoint_mg);
+        migrated = true;
+    }
+    uint8_t ot[OvershootTable::kBlobSize];
+    n = prefs.getBytes(KEY_OT, ot, sizeof ot);
+    if (n == sizeof ot && first.ot.deserialize(ot, n)) {
+        migrated = true;
+    } else if (prefs.isKey(KEY_KV)) {
+        first.ot.seedFromKv(prefs.getFloat(KEY_KV, 0.0f));
+        migrated = true;
+    }
+    if (migrated) {
+        LOGF(INFO, STORAGE, "Migrated setpoint/overshoot into profile %s",
+             first.name);
+        saveProfiles(p);
+        dropLegacyKeys();
+    }
+    return migrated;
+}
+
+void saveProfiles(const ProfileStore& p) {
+    PROF_SCOPE(NVS);
+    static uint8_t blob[ProfileStore::kBlobSize];
+    p.serialize(blob);
+    prefs.putBytes(KEY_PROFILES, blob, sizeof blob);
+}
+
+static const char* latencyKey(Actuator a) {
+    return a == Actuator::PLUG ? KEY_TAU_PLUG : KEY_TAU_RELAY;
+}
+
+// tau and its deviation (uint16, 0.1 ms), then the run count
+void loadLatency(Actuator a, LatencyEstimate& tau) {
+    tau.reset();
+    uint8_t b[5];
+    if (prefs.getBytes(latencyKey(a), b, sizeof b) != sizeof b) return;
+    tau.ms = (uint16_t)(b[0] | (b[1] << 8)) / 10.0f;
+    tau.dev_ms = (uint16_t)(b[2] | (b[3] << 8)) / 10.0f;
+    tau.runs = b[4];
 }
 
-float loadKv(float def) { return prefs.getFloat(KEY_KV, def); }
-void saveKv(float v) {
-    bool hadPrev = prefs.isKey(KEY_KV);
-    float prev = prefs.getFloat(KEY_KV, v);
-    prefs.putFloat(KEY_KV, v);
-    logPersist(KEY_KV, prev, hadPrev, v);
+void saveLatency(Actuator a, const LatencyEstimate& tau) {
+    PROF_SCOPE(NVS);
+    uint16_t ms = (uint16_t)lroundf(fminf(tau.ms, 6000.0f) * 10.0f);
+    uint16_t dev = (uint16_t)lroundf(fminf(tau.dev_ms, 6000.0f) * 10.0f);
+    uint8_t b[5] = {(uint8_t)(ms & 0xFF), (uint8_t)(ms >> 8),
+                    (uint8_t)(dev & 0xFF), (uint8_t)(dev >> 8), tau.runs};
+    prefs.putBytes(latencyKey(a), b, sizeof b);
 }
 }  // namespace storage
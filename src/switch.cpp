@@ -1,5 +1,7 @@
 #include "switch.h"
 
+#include "logging.h"
+
 size_t SwitchWorker::queueDepth() const { return uxQueueMessagesWaiting(_q); }
 
 // Initialize: start task
@@ -16,8 +18,8 @@ bool SwitchWorker::on(const char* ain) { return enqueue(CMD_ON, ain); }
 
 bool SwitchWorker::off(const char* ain) { return enqueue(CMD_OFF, ain); }
 
-bool SwitchWorker::toggle(const char* ain, bool state) {
-    return enqueue(state ? CMD_ON : CMD_OFF, ain);
+bool SwitchWorker::toggle(const char* ain, bool state, TickType_t wait) {
+    return enqueue(state ? CMD_ON : CMD_OFF, ain, wait);
 }
 
 // Optional: stop task and free queue
@@ -32,11 +34,11 @@ void SwitchWorker::end() {
     }
 }
 
-bool SwitchWorker::enqueue(Cmd c, const char* ain) {
+bool SwitchWorker::enqueue(Cmd c, const char* ain, TickType_t wait) {
     if (!_q) return false;
     Request r{c, {0}};
     strlcpy(r.ain, ain, sizeof(r.ain));
-    return xQueueSend(_q, &r, pdMS_TO_TICKS(10)) == pdTRUE;
+    return xQueueSend(_q, &r, wait) == pdTRUE;
 }
 
 // Task body
@@ -50,8 +52,8 @@ void SwitchWorker::taskLoop() {
         if (xQueueReceive(_q, &r, portMAX_DELAY) == pdTRUE) {
             bool ok = (r.cmd == CMD_ON) ? _fritz.switch_on(sid, r.ain)
                                         : _fritz.switch_off(sid, r.ain);
-            Serial.printf("%s %s\n", (r.cmd == CMD_ON ? "ON " : "OFF"),
-                          ok ? "ok" : "fail");
+            LOGF(INFO, SWITCH, "%s %s", (r.cmd == CMD_ON ? "ON " : "OFF"),
+                 ok ? "ok" : "fail");
         }
     }
 }
@@ -0,0 +1,138 @@
+#include "telemetry.h"
+
+#include <math.h>
+
+namespace {
+int16_t sat16(float v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)(v < 0.0f ? v - 0.5f : v + 0.5f);  // no libm call
+}
+
+void put24(uint8_t* p, int32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+}
+
+void putLe(uint8_t*& p, uint64_t v, int bytes) {
+    for (int b = 0; b < bytes; ++b) *p++ = (v >> (8 * b)) & 0xFF;
+}
+}  // namespace
+
+void TelemetryLog::beginRun(const Run& info) {
+    if (open_) endRun(MANUAL, 0, 0);
+    Run& r = runs_[next_run_];
+    r = info;
+    r.first = w_;
+    r.n = 0;
+    if (++number_ == 0) ++number_;  // 0 marks an empty slot
+    r.number = number_;
+    r.end = OPEN;
+    r.overflow = false;
+    open_ = true;
+}
+
+void TelemetryLog::sample(uint64_t t_us, uint8_t lost, int32_t counts,
+                          int32_t x_mg, float v_mgps, float a_mgps2,
+                          float lead_mg, uint8_t flags) {
+    if (!open_) return;
+    Run& r = runs_[next_run_];
+    if (r.n >= kCap) {
+        // would overwrite its own head
+        r.overflow = true;
+        return;
+    }
+    uint64_t dt = r.n ? t_us - last_us_ : 0;
+    if (!r.n) r.t0_us = t_us;
+    last_us_ = t_us;
+
+    Record& e = rec_[wi_];
+    e.dt_us = dt > UINT16_MAX ? UINT16_MAX : (uint16_t)dt;
+    e.flags = flags;
+    e.lost = lost;
+    put24(e.counts, counts);
+    put24(e.x_mg, x_mg);
+    e.v_mgps = sat16(v_mgps);
+    e.a_q = sat16(a_mgps2 * (1.0f / kAccelUnit));
+    e.lead_mg = sat16(lead_mg);
+    w_++;
+    if (++wi_ == kCap) wi_ = 0;
+    r.n++;
+}
+
+void TelemetryLog::endRun(End why, int32_t final_mg, uint64_t cutoff_us) {
+    if (!open_) return;
+    Run& r = runs_[next_run_];
+    r.end = why;
+    r.final_mg = final_mg;
+    r.cutoff_us = cutoff_us;
+    open_ = false;
+    next_run_ = (next_run_ + 1) % TELEMETRY_RUNS;
+}
+
+uint16_t TelemetryLog::crc16(uint16_t crc, const uint8_t* p, size_t n) {
+    // CRC-16/CCITT-FALSE, start with 0xFFFF
+    while (n--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int b = 0; b < 8; ++b)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+void TelemetryLog::dump(HardwareSerial& out) const {
+    uint8_t kept_runs = 0;
+    for (uint8_t k = 0; k < TELEMETRY_RUNS; ++k) {
+        // oldest slot first; an open run is dumped as far as it got
+        const Run& r =
+            runs_[(next_run_ + k + (open_ ? 1 : 0)) % TELEMETRY_RUNS];
+        if (!r.number || !kept(r)) continue;
+        kept_runs++;
+
+        uint8_t hdr[3 + kRunHeaderSize];
+        uint8_t* p = hdr;
+        uint16_t len = kRunHeaderSize + r.n * sizeof(Record);
+        *p++ = FRAME_RUN;
+        putLe(p, len, 2);
+        *p++ = kVersion;
+        putLe(p, r.number, 2);
+        *p++ = r.profile;
+        *p++ = r.end;
+        *p++ = r.overflow;
+        putLe(p, r.t0_us, 8);
+        putLe(p, (uint32_t)r.setpoint_mg, 4);
+        putLe(p, (uint32_t)r.cal_q16, 4);
+        putLe(p, (uint32_t)r.tare_raw, 4);
+        putLe(p, (uint16_t)lroundf(r.tau_ms * 10.0f), 2);
+        putLe(p, (uint32_t)r.final_mg, 4);
+        putLe(p, r.cutoff_us > r.t0_us ? (uint32_t)(r.cutoff_us - r.t0_us) : 0,
+              4);
+        putLe(p, r.n, 2);
+
+        const uint8_t sync[2] = {kSync0, kSync1};
+        out.write(sync, 2);
+        out.write(hdr, sizeof hdr);
+        uint16_t crc = crc16(0xFFFF, hdr, sizeof hdr);
+        // the run's records, in at most two pieces around the ring's end
+        uint32_t i = r.first % kCap, left = r.n;
+        while (left) {
+            uint32_t chunk = kCap - i < left ? kCap - i : left;
+            const uint8_t* b = (const uint8_t*)&rec_[i];
+            out.write(b, chunk * sizeof(Record));
+            crc = crc16(crc, b, chunk * sizeof(Record));
+            left -= chunk;
+            i = 0;
+        }
+        uint8_t c[2] = {(uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)};
+        out.write(c, 2);
+    }
+
+    uint8_t end[5] = {kSync0, kSync1, FRAME_END, 1, 0};
+    uint8_t body = kept_runs;
+    uint16_t crc = crc16(crc16(0xFFFF, end + 2, 3), &body, 1);
+    out.write(end, sizeof end);
+    out.write(&body, 1);
+    uint8_t c[2] = {(uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)};
+    out.write(c, 2);
+}
@@ -0,0 +1,23 @@
+#include "topup.h"
+
+#include <math.h>
+
+uint32_t PulseModel::lengthMs(int32_t deficit_mg, float flow_mgps) const {
+    float k = mg_per_ms;
+    if (pulses == 0) {
+        if (flow_mgps < V_MIN_GPS * 1000.0f) return 0;
+        k = flow_mgps / 1000.0f;
+    }
+    float ms = TOPUP_DEAD_MS + (float)deficit_mg / k;
+    if (ms < TOPUP_MIN_MS) ms = TOPUP_MIN_MS;
+    if (ms > TOPUP_MAX_MS) ms = TOPUP_MAX_MS;
+    return (uint32_t)lroundf(ms);
+}
+
+void PulseModel::learn(uint32_t len_ms, int32_t delivered_mg) {
+    if (len_ms <= TOPUP_DEAD_MS || delivered_mg <= 0) return;
+    float k = (float)delivered_mg / (float)(len_ms - TOPUP_DEAD_MS);
+    float gain = fmaxf(1.0f / (pulses + 1), TOPUP_MIN_GAIN);
+    mg_per_ms = pulses ? mg_per_ms + gain * (k - mg_per_ms) : k;
+    if (pulses < 255) pulses++;
+}
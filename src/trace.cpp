@@ -0,0 +1,35 @@
+#include "trace.h"
+
+void TraceRecorder::begin(const Header& h, uint64_t t0_us) {
+    h_ = h;
+    t0_us_ = t0_us;
+    n_ = 0;
+    overflow_ = false;
+    recording_ = true;
+}
+
+void TraceRecorder::add(uint64_t t_us, int32_t value, uint8_t kind) {
+    if (!recording_) return;
+    if (n_ >= TRACE_MAX_EVENTS) {
+        overflow_ = true;
+        return;
+    }
+    ev_[n_++] = {(uint32_t)(t_us - t0_us_), value, kind};
+}
+
+void TraceRecorder::dump(HardwareSerial& out) const {
+    out.printf(
+        "#trace v3 cal_q16=%ld tare_raw=%ld setpoint_mg=%ld tau_comm_ms=%.3f "
+        "ot=",
+        (long)h_.cal_q16, (long)h_.tare_raw, (long)h_.setpoint_mg,
+        (double)h_.tau_comm_ms);
+    for (size_t i = 0; i < sizeof h_.ot; ++i) out.printf("%02x", h_.ot[i]);
+    out.printf(" offset_counts=%ld events=%u%s\n", (long)SCALE_OFFSET_COUNTS,
+               (unsigned)n_, overflow_ ? " overflow" : "");
+    for (uint16_t i = 0; i < n_; ++i) {
+        const Event& e = ev_[i];
+        out.printf("%c,%lu,%ld\n", e.kind == SAMPLE ? 'S' : 'R',
+                   (unsigned long)e.dt_us, (long)e.value);
+    }
+    out.printf("#end\n");
+}
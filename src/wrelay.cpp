@@ -9,3 +9,9 @@ void WifiRelay::set(bool on) {
 
     _worker.toggle(ain_, on);
 }
+
+bool WifiRelay::trySet(bool on) {
+    Relay::set(on);
+
+    return _worker.toggle(ain_, on, 0);
+}
@@ -0,0 +1,79 @@
+// Fast estimators: ramp tracking and the steady-state Kalman against the
+// full-covariance reference it is derived from.
+#include <unity.h>
+
+#include "config.h"
+#include "estimator.h"
+
+namespace {
+constexpr uint32_t kDtUs = 1000000 / 80;
+
+// deterministic +-15 mg noise
+float noiseMg(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (float)((int32_t)(seed >> 16) % 31 - 15);
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// Constant-acceleration model: a clean ramp is tracked without lag
+void test_kalman_tracks_ramp() {
+    KalmanCaEstimator kf;
+    kf.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+    const float flow = 2000.0f;  // mg/s
+    float t = 0.0f;
+    for (int i = 0; i < 160; ++i, t += kDtUs * 1e-6f)
+        kf.update(500.0f + flow * t, kDtUs);
+    t -= kDtUs * 1e-6f;
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 500.0f + flow * t, kf.x());
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, flow, kf.v());
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, 0.0f, kf.a());
+}
+
+void test_alpha_beta_tracks_ramp() {
+    AlphaBetaEstimator ab;
+    const float flow = 2000.0f;
+    float t = 0.0f;
+    for (int i = 0; i < 160; ++i, t += kDtUs * 1e-6f)
+        ab.update(flow * t, kDtUs);
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, flow, ab.v());
+}
+
+// A cup at rest reads as no flow, whatever the noise
+void test_kalman_at_rest() {
+    KalmanCaEstimator kf;
+    kf.setNoise({KF_Q_JERK_IDLE, KF_R_IDLE_MG2});
+    uint32_t seed = 1;
+    for (int i = 0; i < 400; ++i) kf.update(18000.0f + noiseMg(seed), kDtUs);
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, 18000.0f, kf.x());
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, 0.0f, kf.v());
+}
+
+// Once the covariance has converged the gain table gives the same states
+void test_kalman_table_matches_full() {
+    KalmanCaFull ref;
+    KalmanCaEstimator kf;
+    ref.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+    kf.setNoise({KF_Q_JERK_FAST, KF_R_FAST_MG2});
+    uint32_t seed = 7;
+    float t = 0.0f;
+    for (int i = 0; i < 400; ++i, t += kDtUs * 1e-6f) {
+        float z = 1500.0f * t + 400.0f * t * t + noiseMg(seed);
+        ref.update(z, kDtUs);
+        kf.update(z, kDtUs);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, ref.x(), kf.x());
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, ref.v(), kf.v());
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, ref.a(), kf.a());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_kalman_tracks_ramp);
+    RUN_TEST(test_alpha_beta_tracks_ramp);
+    RUN_TEST(test_kalman_at_rest);
+    RUN_TEST(test_kalman_table_matches_full);
+    return UNITY_END();
+}
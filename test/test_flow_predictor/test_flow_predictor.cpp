@@ -0,0 +1,113 @@
+// Sliding least-squares fit: the O(1) integer moments against a
+// double-precision refit of the same window.
+#include <math.h>
+#include <unity.h>
+
+#include "flow_predictor.h"
+
+namespace {
+constexpr uint32_t kDtUs = 1000000 / 80;
+constexpr uint32_t kN = FlowPredictor::kN;
+
+uint32_t lcg(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// Quadratic in the sample index j = -(N-1)..0 by normal equations (Gauss),
+// scaled to seconds with the window's mean spacing like FlowPredictor::fit()
+FlowPredictor::Fit refit(const int32_t* y, const uint64_t* t) {
+    double M[3][4] = {};
+    for (uint32_t k = 0; k < kN; ++k) {
+        double j = (double)k - (kN - 1);
+        double p[3] = {1.0, j, j * j};
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) M[r][c] += p[r] * p[c];
+            M[r][3] += p[r] * y[k];
+        }
+    }
+    for (int i = 0; i < 3; ++i)
+        for (int r = i + 1; r < 3; ++r) {
+            double f = M[r][i] / M[i][i];
+            for (int c = i; c < 4; ++c) M[r][c] -= f * M[i][c];
+        }
+    double c[3];
+    for (int i = 2; i >= 0; --i) {
+        double s = M[i][3];
+        for (int k = i + 1; k < 3; ++k) s -= M[i][k] * c[k];
+        c[i] = s / M[i][i];
+    }
+    double ts = (t[kN - 1] - t[0]) * 1e-6 / (kN - 1);
+    return {(float)c[0], (float)(c[1] / ts), (float)(2.0 * c[2] / (ts * ts))};
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// 100k readings of a noisy grind that speeds up and slows down, up to a
+// few kg: after every push the fit must match the refit
+void test_matches_double_refit() {
+    FlowPredictor fp;
+    int32_t y[kN];
+    uint64_t t[kN];
+    uint32_t seed = 3;
+    uint64_t now = 0xFFFFFFFFull - 1000000;  // low 32 bits wrap early on
+    double mass = 0.0;
+    for (uint32_t i = 0; i < 100000; ++i) {
+        now += kDtUs - 1000 + lcg(seed) % 2000;
+        double flow = 2000.0 + 1500.0 * sin(i * 0.01);  // mg/s
+        mass += flow * kDtUs * 1e-6;
+        int32_t mg = (int32_t)lround(mass) + (int32_t)(lcg(seed) % 41) - 20;
+        fp.push(now, mg);
+        for (uint32_t k = 0; k + 1 < kN; ++k) {
+            y[k] = y[k + 1];
+            t[k] = t[k + 1];
+        }
+        y[kN - 1] = mg;
+        t[kN - 1] = now;
+        if (i + 1 < kN) {
+            TEST_ASSERT_FALSE(fp.ready());
+            continue;
+        }
+        TEST_ASSERT_TRUE(fp.ready());
+        FlowPredictor::Fit f = fp.fit(), r = refit(y, t);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, r.m, f.m);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f + 1e-4f * fabsf(r.v), r.v, f.v);
+        TEST_ASSERT_FLOAT_WITHIN(20.0f + 1e-3f * fabsf(r.a), r.a, f.a);
+    }
+}
+
+// A missed conversion breaks the index grid: the window starts over
+void test_gap_restarts_window() {
+    FlowPredictor fp;
+    uint64_t now = 0;
+    for (uint32_t i = 0; i < kN; ++i) fp.push(now += kDtUs, (int32_t)i * 25);
+    TEST_ASSERT_TRUE(fp.ready());
+    fp.push(now += 3 * kDtUs, 0);
+    TEST_ASSERT_FALSE(fp.ready());
+}
+
+// Exact ramp: v is the ramp's slope and timeTo() lands on the target
+void test_ramp_time_to_target() {
+    FlowPredictor fp;
+    uint64_t now = 0;
+    for (uint32_t i = 0; i < kN; ++i) {
+        now += kDtUs;
+        fp.push(now, (int32_t)(now / 500));  // 2000 mg/s
+    }
+    FlowPredictor::Fit f = fp.fit();
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 2000.0f, f.v);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.5f,
+                             FlowPredictor::timeTo(f, f.m + 1000.0f));
+    TEST_ASSERT_TRUE(FlowPredictor::reachesWithin(f, f.m + 1000.0f, 0.6f));
+    TEST_ASSERT_FALSE(FlowPredictor::reachesWithin(f, f.m + 1000.0f, 0.4f));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_double_refit);
+    RUN_TEST(test_gap_restarts_window);
+    RUN_TEST(test_ramp_time_to_target);
+    return UNITY_END();
+}
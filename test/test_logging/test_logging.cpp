@@ -0,0 +1,125 @@
+// Log drain around serial dumps: records queued while a telemetry dump is
+// written must not land inside its frames, and come out once it is done.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "hal_native.h"
+#include "logging.h"
+#include "telemetry.h"
+
+int cmdDecode(int argc, char** argv);  // src/native/decode.cpp
+
+namespace {
+TelemetryLog telem;
+constexpr int kRuns = 3;
+constexpr int kSamples = 40;
+constexpr int kLines = 6;
+
+char dump_path[] = "/tmp/test_logging_dumpXXXXXX";
+char csv_path[] = "/tmp/test_logging_csvXXXXXX";
+
+void recordRuns() {
+    for (int r = 0; r < kRuns; ++r) {
+        TelemetryLog::Run info;
+        info.setpoint_mg = 18000;
+        info.tau_ms = 70.0f;
+        telem.beginRun(info);
+        uint64_t t = 1000000ull * (r + 1);
+        for (int i = 0; i < kSamples; ++i, t += 12500)
+            telem.sample(t, 0, 100 * i, 50 * i, 4000.0f, 0.0f, 300.0f,
+                         TelemetryLog::RELAY);
+        telem.endRun(TelemetryLog::AUTO, 18050, t);
+    }
+}
+
+std::vector<uint8_t> readAll(const char* path) {
+    std::vector<uint8_t> buf;
+    FILE* f = fopen(path, "rb");
+    if (!f) return buf;
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof chunk, f)) > 0)
+        buf.insert(buf.end(), chunk, chunk + got);
+    fclose(f);
+    return buf;
+}
+
+size_t find(const std::vector<uint8_t>& buf, const std::string& s,
+            size_t from) {
+    return std::string(buf.begin(), buf.end()).find(s, from);
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_dump_is_not_split_by_log_lines() {
+    close(mkstemp(dump_path));
+    close(mkstemp(csv_path));
+    FILE* f = fopen(dump_path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    hal::setSerialFile(f);
+    hal::setSerialEcho(true);
+    logging::begin();  // no task on the host: update() drains
+
+    for (int i = 0; i < kLines / 2; ++i)
+        LOGF(INFO, MAIN, "queued before the dump %d", i);
+    logging::pause();
+    logging::update();  // where the drain would run mid-dump
+    telem.dump(Serial);
+    for (int i = kLines / 2; i < kLines; ++i)
+        LOGF(INFO, MAIN, "queued during the dump %d", i);
+    logging::update();
+    logging::resume();
+
+    hal::setSerialEcho(false);
+    hal::setSerialFile(nullptr);
+    fclose(f);
+
+    std::vector<uint8_t> buf = readAll(dump_path);
+    TEST_ASSERT_TRUE(buf.size() > 2);
+    TEST_ASSERT_EQUAL_HEX8(TelemetryLog::kSync0, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(TelemetryLog::kSync1, buf[1]);
+    // the end frame comes before every log line, and all of them are out
+    const char end[] = {(char)TelemetryLog::kSync0, (char)TelemetryLog::kSync1,
+                        (char)TelemetryLog::FRAME_END, 1, 0};
+    size_t at = find(buf, std::string(end, sizeof end), 0);
+    TEST_ASSERT_TRUE(at != std::string::npos);
+    TEST_ASSERT_TRUE(find(buf, "queued", 0) > at);
+    int lines = 0;
+    for (size_t p = at; (p = find(buf, "queued", p)) != std::string::npos;
+         ++p)
+        lines++;
+    TEST_ASSERT_EQUAL_INT(kLines, lines);
+
+    // every run decodes: one CSV line per sample
+    char* argv[] = {dump_path, csv_path};
+    TEST_ASSERT_EQUAL_INT(0, cmdDecode(2, argv));
+    FILE* csv = fopen(csv_path, "r");
+    TEST_ASSERT_NOT_NULL(csv);
+    char line[256];
+    int rows = 0, runs = 0;
+    while (fgets(line, sizeof line, csv)) {
+        if (line[0] == '#') runs++;
+        else if (strncmp(line, "run,", 4)) rows++;
+    }
+    fclose(csv);
+    TEST_ASSERT_EQUAL_INT(kRuns, runs);
+    TEST_ASSERT_EQUAL_INT(kRuns * kSamples, rows);
+
+    unlink(dump_path);
+    unlink(csv_path);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    recordRuns();
+    RUN_TEST(test_dump_is_not_split_by_log_lines);
+    return UNITY_END();
+}
@@ -0,0 +1,87 @@
+// SPSC sample ring, MPSC log queue and the latest-value triple buffer,
+// single-threaded: ordering, drops and history.
+#include <unity.h>
+
+#include "ring.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_spsc_order_and_drop() {
+    SpscRing<uint32_t, 8> r;
+    TEST_ASSERT_NULL(r.front());
+    for (uint32_t i = 0; i < 8; ++i) TEST_ASSERT_TRUE(r.push(i));
+    TEST_ASSERT_FALSE(r.push(8));  // full: dropped, not overwritten
+    TEST_ASSERT_EQUAL_UINT32(1, r.dropped());
+    TEST_ASSERT_EQUAL_UINT32(8, r.size());
+    for (uint32_t i = 0; i < 8; ++i) {
+        uint32_t v;
+        TEST_ASSERT_TRUE(r.pop(v));
+        TEST_ASSERT_EQUAL_UINT32(i, v);
+    }
+    TEST_ASSERT_NULL(r.front());
+}
+
+// Popped records stay readable until HISTORY newer ones have been popped
+void test_spsc_history() {
+    SpscRing<uint32_t, 8, 3> r;
+    TEST_ASSERT_EQUAL_UINT32(5, r.capacity());
+    for (uint32_t i = 0; i < 5; ++i) TEST_ASSERT_TRUE(r.push(i));
+    TEST_ASSERT_FALSE(r.push(5));
+    TEST_ASSERT_NULL(r.history(0));
+    for (uint32_t i = 0; i < 4; ++i) r.pop();
+    TEST_ASSERT_EQUAL_UINT32(3, *r.history(0));
+    TEST_ASSERT_EQUAL_UINT32(1, *r.history(2));
+    TEST_ASSERT_NULL(r.history(3));
+    // wraps around the buffer without touching the history
+    for (uint32_t i = 5; i < 9; ++i) TEST_ASSERT_TRUE(r.push(i));
+    TEST_ASSERT_EQUAL_UINT32(1, *r.history(2));
+    TEST_ASSERT_EQUAL_UINT32(4, *r.front());
+}
+
+void test_mpsc_claim_publish() {
+    MpscQueue<uint32_t, 4> q;
+    uint32_t t0 = 0, t1 = 0;
+    uint32_t* a = q.claim(t0);
+    uint32_t* b = q.claim(t1);
+    *a = 10;
+    *b = 11;
+    q.publish(t1);
+    TEST_ASSERT_NULL(q.front());  // the older claim holds the consumer up
+    q.publish(t0);
+    TEST_ASSERT_EQUAL_UINT32(10, *q.front());
+    q.pop();
+    TEST_ASSERT_EQUAL_UINT32(11, *q.front());
+    q.pop();
+    TEST_ASSERT_NULL(q.front());
+    for (uint32_t i = 0; i < 4; ++i) {
+        *q.claim(t0) = i;
+        q.publish(t0);
+    }
+    TEST_ASSERT_NULL(q.claim(t0));
+    TEST_ASSERT_EQUAL_UINT32(1, q.dropped());
+}
+
+void test_latest_value() {
+    LatestValue<int> lv;
+    TEST_ASSERT_NULL(lv.take());
+    lv.publish(1);
+    lv.publish(2);
+    lv.publish(3);
+    const int* v = lv.take();
+    TEST_ASSERT_NOT_NULL(v);
+    TEST_ASSERT_EQUAL_INT(3, *v);  // older values are replaced, not queued
+    TEST_ASSERT_NULL(lv.take());
+    lv.publish(4);
+    TEST_ASSERT_EQUAL_INT(3, *v);  // the taken value stays put until take()
+    TEST_ASSERT_EQUAL_INT(4, *lv.take());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_order_and_drop);
+    RUN_TEST(test_spsc_history);
+    RUN_TEST(test_mpsc_claim_publish);
+    RUN_TEST(test_latest_value);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+// Sliding-window stability detector: window edges, peak-to-peak and the
+// integer variance test.
+#include <math.h>
+#include <unity.h>
+
+#include <deque>
+
+#include "stability.h"
+
+namespace {
+constexpr uint32_t kDtUs = 1000000 / 80;
+
+// Reference: the same window rules on a plain deque, everything recomputed
+// from scratch on every reading
+struct NaiveWindow {
+    struct Entry {
+        uint32_t t_us;
+        int32_t mg;
+    };
+    std::deque<Entry> q;
+    uint32_t win_us;
+
+    void push(uint64_t t_us, int32_t mg) {
+        uint32_t t = (uint32_t)t_us;
+        while (!q.empty() && (t - q.front().t_us >= win_us ||
+                              q.size() >= StabilityDetector::kCap))
+            q.pop_front();
+        q.push_back({t, mg});
+    }
+    int32_t peakToPeak() const {
+        int32_t lo = q.front().mg, hi = lo;
+        for (const Entry& e : q) {
+            if (e.mg < lo) lo = e.mg;
+            if (e.mg > hi) hi = e.mg;
+        }
+        return hi - lo;
+    }
+    // n^2 * population variance, exact
+    int64_t m2() const {
+        int64_t n = q.size(), s = 0, ss = 0;
+        for (const Entry& e : q) {
+            s += e.mg;
+            ss += (int64_t)e.mg * e.mg;
+        }
+        return n * ss - s * s;
+    }
+};
+
+uint32_t lcg(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_full_after_one_window() {
+    StabilityDetector d(1000);
+    uint64_t t = 0;
+    for (; t < 1000000; t += kDtUs) {
+        d.push(t, 0);
+        TEST_ASSERT_FALSE(d.full());
+    }
+    d.push(t, 0);
+    TEST_ASSERT_TRUE(d.full());
+    TEST_ASSERT_EQUAL_UINT32(80, d.count());
+}
+
+// A step leaves the window one window length later
+void test_peak_to_peak_expires() {
+    StabilityDetector d(1000);
+    uint64_t t = 0;
+    for (int i = 0; i < 80; ++i, t += kDtUs) d.push(t, i == 10 ? 500 : 0);
+    TEST_ASSERT_EQUAL_INT32(500, d.peakToPeak());
+    for (int i = 0; i < 11; ++i, t += kDtUs) d.push(t, 0);
+    TEST_ASSERT_EQUAL_INT32(0, d.peakToPeak());
+}
+
+void test_stddev_limit() {
+    StabilityDetector d(1000);
+    uint64_t t = 0;
+    // alternating +-30 mg: population sd exactly 30
+    for (int i = 0; i < 80; ++i, t += kDtUs) d.push(t, i & 1 ? 30 : -30);
+    TEST_ASSERT_TRUE(d.stddevWithin(30));
+    TEST_ASSERT_FALSE(d.stddevWithin(29));
+}
+
+// More readings than kCap within a window: the oldest go first
+void test_capacity_bound() {
+    StabilityDetector d(1000);
+    for (uint32_t i = 0; i < 3 * StabilityDetector::kCap; ++i)
+        d.push((uint64_t)i * 1000, (int32_t)i);
+    TEST_ASSERT_EQUAL_UINT32(StabilityDetector::kCap, d.count());
+    TEST_ASSERT_EQUAL_INT32(StabilityDetector::kCap - 1, d.peakToPeak());
+}
+
+// 250k readings with jittered spacing, dropouts, bursts of fast readings
+// (beyond kCap per window), steps and the 32-bit timestamp wrap: the O(1)
+// deques and moments must agree with the brute-force window every time
+void test_matches_naive_window() {
+    StabilityDetector d(STAB_WINDOW_MS);
+    NaiveWindow ref{{}, STAB_WINDOW_MS * 1000u};
+    uint32_t seed = 42;
+    uint64_t t = 0xFFFFFFFFull - 3000000;  // wraps after ~3 s
+    int32_t level = 18000;
+    uint32_t burst = 0;
+    for (uint32_t i = 0; i < 250000; ++i) {
+        uint32_t r = lcg(seed);
+        if (r % 2000 == 0) burst = 300;
+        if (r % 5000 == 1) {
+            t += 2000000;  // dropout
+        } else if (burst) {
+            burst--;
+            t += 500 + r % 1000;
+        } else {
+            t += kDtUs - 500 + r % 1000;  // jitter
+        }
+        if (r % 3000 == 2) level += (int32_t)(r % 40001) - 20000;  // step
+        int32_t mg = level + (int32_t)(lcg(seed) % 121) - 60;
+        d.push(t, mg);
+        ref.push(t, mg);
+
+        TEST_ASSERT_EQUAL_UINT32(ref.q.size(), d.count());
+        TEST_ASSERT_EQUAL_INT32(ref.peakToPeak(), d.peakToPeak());
+        // largest sd limit the window fails: floor(sqrt(var)) - 1
+        int64_t n = ref.q.size(), m2 = ref.m2();
+        int64_t sd = (int64_t)sqrt((double)m2) / n;
+        while ((sd + 1) * (sd + 1) * n * n <= m2) sd++;
+        while (sd > 0 && sd * sd * n * n > m2) sd--;
+        TEST_ASSERT_TRUE(d.stddevWithin((int32_t)sd));
+        if (sd > 0) TEST_ASSERT_FALSE(d.stddevWithin((int32_t)sd - 1));
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_after_one_window);
+    RUN_TEST(test_peak_to_peak_expires);
+    RUN_TEST(test_stddev_limit);
+    RUN_TEST(test_capacity_bound);
+    RUN_TEST(test_matches_naive_window);
+    return UNITY_END();
+}